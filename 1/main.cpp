@@ -6,6 +6,9 @@ using namespace std;
 #include <vector>
 #include <map>
 
+#include "../common/dialects.h"
+#include "../common/operand.h"
+
 enum LexemType{
 	UNKNOWN,
 	ONE_CHAR,
@@ -28,6 +31,7 @@ struct Lexem {
 	LexemType type;
 	string text;
 	int index;
+	Term term;
 };
 
 map<LexemType, string> lexemInfo = {
@@ -48,63 +52,28 @@ map<LexemType, string> lexemInfo = {
 	{COMMAND, "command"}
 };
 
-map<string, LexemType> lexemType = {
-	{"assume", DIRECTIVE},
-	{"end", DIRECTIVE},
-	{"segment", DIRECTIVE},
-	{"ends", DIRECTIVE},
-	{"equ", DIRECTIVE},
-	{"if", DIRECTIVE}, 
-	{"else", DIRECTIVE},
-	{"endif", DIRECTIVE},
-
-	{"db", DATA_TYPE},
-	{"dw", DATA_TYPE},
-	{"dd", DATA_TYPE},
-
-	{"byte", PTR_TYPE},
-	{"dword", PTR_TYPE},
-	{"ptr", PTR_PTR},
-
-	{"eax", REG_32},
-	{"ebx", REG_32},
-	{"ecx", REG_32},
-	{"edx", REG_32},
-	{"esi", REG_32},
-	{"edi", REG_32},
-	{"esp", REG_32},
-	{"ebp", REG_32},
-
-	{"ah", REG_8},
-	{"bh", REG_8},
-	{"ch", REG_8},
-	{"dh", REG_8},
-	{"al", REG_8},
-	{"bl", REG_8},
-	{"cl", REG_8},
-	{"dl", REG_8},
-
-	{"cs", SEG_REG},
-	{"ds", SEG_REG},
-	{"ss", SEG_REG},
-	{"es", SEG_REG},
-	{"fs", SEG_REG},
-	{"gs", SEG_REG},
-
-	{"pusha", COMMAND},
-	{"inc", COMMAND},
-	{"dec", COMMAND},
-	{"xchg", COMMAND},
-	{"lea", COMMAND},
-	{"and", COMMAND},
-	{"mov", COMMAND},
-	{"or", COMMAND},
-	{"jb", COMMAND}
-};
+LexemType lexemType(const Token &token) {
+	switch (token.type) {
+		case Token::OneChar: return ONE_CHAR;
+		case Token::Identifier: return USER_IDENT;
+		case Token::String: return STR_CONST;
+		case Token::Number: return token.radix == 2 ? BIN_CONST : (token.radix == 16 ? HEX_CONST : DEC_CONST);
+		case Token::Directive: return DIRECTIVE;
+		case Token::DataType: return DATA_TYPE;
+		case Token::PtrType: return PTR_TYPE;
+		case Token::Operator: return PTR_PTR;
+		case Token::SReg: return SEG_REG;
+		case Token::Reg32: return REG_32;
+		case Token::Reg8: return REG_8;
+		case Token::Command: return COMMAND;
+		default: return UNKNOWN;
+	}
+}
 
-inline bool isonechar(char c) {
-	return (c == '+') || (c == '-') || (c == '*') || (c == ':') || (c == ',') || (c == '[') || (c == ']');
-};
+// Register number or size a keyword stands for.
+constexpr int code(const char *text) {
+	return stage1.keywords[stage1.keywords.find(text)].code;
+}
 
 map<int, string> symbolType = {
 	{-3, "ЧИСЛО"},
@@ -120,156 +89,130 @@ struct Symbol {
 	int type;
 };
 
+// Cursor over a span of one line's lexems. It never copies them, so the
+// line has to outlive it.
 struct Matcher {
-	vector<Lexem> lexems;
-	int index;
+	const Lexem *lexems;
+	int count, index;
 
-	Matcher() : index(0) {}
-	Matcher(const vector<Lexem> &lexems) : lexems(lexems), index(0) {}
+	Matcher(const vector<Lexem> &lexems) : Matcher(lexems.data(), lexems.size()) {}
+	Matcher(const Lexem *lexems, int count) : lexems(lexems), count(count), index(0) {}
 
 	void reset() { index = 0; }
-	void next() { if (index < lexems.size()) index++; }
-	Lexem &peek() {
-		static Lexem lexem;
-		return index < lexems.size() ? lexems[index] : lexem;
-	}
-	Lexem &get() {
-		Lexem &lexem = peek();
-		next();
-		return lexem;
-	}
-	void push(const Lexem &lexem) {
-		lexems.push_back(lexem);
-	}
+	void next() { if (index < count) index++; }
 
-	bool compare(const string &text) {
-		return peek().text.compare(text) == 0;
+	bool compare(const char *text) const {
+		return has() && (lexems[index].text.compare(text) == 0);
 	}
 
-	bool confirm(const string &text) {
+	bool confirm(const char *text) {
 		return compare(text) ? next(), true : false;
 	}
 
-	bool compare(const LexemType &type) {
-		return peek().type == type;
+	bool compare(const LexemType &type) const {
+		return has() && (lexems[index].type == type);
 	}
 
 	bool confirm(const LexemType &type) {
 		return compare(type) ? next(), true : false;
 	}
 
-	bool has() {
-		return index < lexems.size();
+	bool has() const {
+		return index < count;
 	}
 };
 
-struct Operand {
-	vector<Lexem> lexems;
-
-	int ptr, scale, imm, disp;
-	Lexem reg, base, index;
-	string sreg, ident, text;
-
-	Operand(const vector<Lexem> &lexems) : lexems(lexems) { 
-		Matcher matcher(lexems);
-
-		ptr = 0;
-		scale = 0;
-		imm = 0;
-		disp = 0;
-		reg = {LexemType::UNKNOWN, "", 0};
-		base = {LexemType::UNKNOWN, "", 0};
-		index = {LexemType::UNKNOWN, "", 0};
-
-		if (matcher.compare(PTR_TYPE)) {
-			string ptr = matcher.get().text;
-
-			if (matcher.confirm(PTR_PTR)) {
-				if (ptr.compare("byte") == 0) {
-					this->ptr = 1;
-				} else if (ptr.compare("word") == 0) {
-					this->ptr = 2;
-				} else if (ptr.compare("dword") == 0) {
-					this->ptr = 4;
-				}
-			}
-		}
-
-		if (matcher.compare(REG_8) || matcher.compare(REG_32)) {
-			this->reg = matcher.get();
-		} else if (matcher.compare(BIN_CONST)) {
-			this->imm = stol(matcher.get().text, 0, 2);
-		} else if (matcher.compare(DEC_CONST)) {
-			this->imm = stol(matcher.get().text, 0, 10);
-		} else if (matcher.compare(HEX_CONST)) {
-			this->imm = stol(matcher.get().text, 0, 16);
-		} else if (matcher.compare(STR_CONST)) {
-			this->text = matcher.get().text;
-		}
+constexpr Rule stage1Operand[] = {
+	{0, Term::PtrType, 1, PendPtr, true},
+	{0, Term::Classes, 2, Skip, false},
+	{1, Term::Ptr, 2, SetPtr, true},
+	{1, Term::Classes, 2, Skip, false},
+	{2, Term::Reg8, 3, SetReg, true},
+	{2, Term::Reg32, 3, SetReg, true},
+	{2, Term::Number, 3, SetImm, true},
+	{2, Term::String, 3, SetText, true},
+	{2, Term::Classes, 3, Skip, false},
+	// [sreg:][name]
+	{3, Term::SReg, 4, PendSReg, true},
+	{3, Term::Classes, 5, Skip, false},
+	{4, Term::Colon, 5, SetSReg, true},
+	{4, Term::Classes, 5, Skip, false},
+	{5, Term::Identifier, 6, SetIdent, true},
+	{5, Term::Classes, 6, Skip, false},
+	// [[base + index + disp]]
+	{6, Term::Open, 7, OpenMem, true},
+	{6, Term::Classes, OperandGrammar::Accept, Skip, false},
+	{7, Term::Reg8, 8, SetBase, true},
+	{7, Term::Classes, 12, Skip, false},
+	{8, Term::Plus, 9, Skip, true},
+	{8, Term::Classes, 12, Skip, false},
+	{9, Term::End, 12, Skip, false},
+	{9, Term::Classes, 10, SetIndex, true},
+	{10, Term::Plus, 11, Skip, true},
+	{10, Term::Classes, 12, Skip, false},
+	{11, Term::Number, 12, SetDisp, true},
+	{11, Term::Classes, 12, Skip, false},
+	{12, Term::Close, OperandGrammar::Accept, Skip, true},
+	{12, Term::Classes, OperandGrammar::Accept, Skip, false}
+};
 
-		if (matcher.compare(SEG_REG)) {
-			Lexem &sreg = matcher.get();
-			if (matcher.confirm(":")) {
-				this->sreg = sreg.text;
-			}
-		}
+constexpr OperandGrammar operandGrammar(stage1Operand);
 
-		if (matcher.compare(USER_IDENT)) {
-			this->ident = matcher.get().text;
-		}
+// Operand over the lexems [first, first + count) of its sentence.
+struct Operand : Descriptor {
+	int first, count;
 
-		if (matcher.confirm("[")) {
-			if (matcher.compare(REG_8)) {
-				this->base = matcher.get();
-				if (matcher.confirm("+")) {
-					this->index = matcher.get();
-					this->scale = 1;
-					if (matcher.confirm("+")) {
-						if (matcher.compare(BIN_CONST)) {
-							this->disp = stol(matcher.get().text, 0, 2);
-						} else if (matcher.compare(DEC_CONST)) {
-							this->disp = stol(matcher.get().text, 0, 10);
-						} else if (matcher.compare(HEX_CONST)) {
-							this->disp = stol(matcher.get().text, 0, 16);
-						}
-					}
-				}
-			}
-			matcher.confirm("]");
-		}
-	}
+	Operand(const vector<Lexem> &lexems, int first, int count) : Descriptor(operandGrammar.parse(lexems.data() + first, count)), first(first), count(count) {}
 };
 
 struct Sentence {
 	vector<Operand> operands;
-	vector<Lexem> mnemocode;
 	vector<Lexem> lexems;
-	vector<Lexem> label;
 	string input, bytes;
+	// Positions of the label and the mnemocode, -1 without.
+	int label, mnemo;
+	// The label is followed by ':'.
+	bool colon;
 	unsigned length;
 	unsigned offset;
 
-	Sentence(const string &input, const vector<Lexem> &lexems) : input(input), lexems(lexems), length(0), offset(0) {
-		Matcher matcher(lexems);
+	Sentence(const string &input, vector<Lexem> &&lexems) : lexems(move(lexems)), input(input), label(-1), mnemo(-1), colon(false), length(0), offset(0) {
+		Matcher matcher(this->lexems);
 
 		if (matcher.compare(USER_IDENT)) {
-			label.push_back(matcher.get());
-			if (matcher.compare(":")) 
-				label.push_back(matcher.get());
+			label = matcher.index;
+			matcher.next();
+			colon = matcher.confirm(":");
 		}
 
 		if (matcher.compare(DIRECTIVE) || matcher.compare(COMMAND) || matcher.compare(DATA_TYPE)) {
-			mnemocode.push_back(matcher.get());
+			mnemo = matcher.index;
+			matcher.next();
 		}
 
 		while (matcher.has()) {
-			vector<Lexem> lexems;
-			while (matcher.has() && !matcher.confirm(",")) {
-				lexems.push_back(matcher.get());
+			int first = matcher.index;
+			while (matcher.has() && !matcher.compare(",")) {
+				matcher.next();
 			}
-			operands.push_back(lexems);
+			operands.push_back(Operand(this->lexems, first, matcher.index - first));
+			matcher.confirm(",");
 		}
 	} 
+
+	const Lexem &mnemocode() const {
+		return lexems[mnemo];
+	}
+
+	// Text of an operand's identifier, empty without one.
+	string name(const Operand &operand) const {
+		return operand.ident == -1 ? "" : lexems[operand.first + operand.ident].text;
+	}
+
+	// Text of an operand's string, empty without one.
+	string str(const Operand &operand) const {
+		return operand.text == -1 ? "" : lexems[operand.first + operand.text].text;
+	}
 };
 
 map<string, string> segmentPrefixes = {
@@ -285,7 +228,7 @@ struct IF { bool value; };
 struct FirstView {
 	map<string, unsigned> segment_table;
 	map<string, Symbol> symbol_table;
-	map<string, string> assume_table;
+	map<int, string> assume_table;
 	vector<Sentence> sentences;
 	string default_segment;
 	Sentence *sentence;
@@ -305,56 +248,28 @@ struct FirstView {
 
 vector<Lexem> FirstView::divide(const string &input) {
 	vector<Lexem> lexems;
-	for (int i = 0, index = 0; i < input.size();) {
-		if (input[i] == ';') break;
-		else if (isspace(input[i])) i++;
-		else {
-			Lexem lexem;
-			lexem.index = index++;
-			if (isalpha(input[i])) {
-				while ((i < input.size()) && isalnum(input[i])) {
-					lexem.text += tolower(input[i++]);
-				}
-				auto type = lexemType.find(lexem.text);
-				if (type != lexemType.end()) {
-					lexem.type = type->second;
-				} else lexem.type = USER_IDENT;
-			} else if (isdigit(input[i])) {
-				while ((i < input.size()) && isxdigit(input[i])) {
-					lexem.text += tolower(input[i++]);
-				}
-				if (tolower(input.back()) == 'b') {
-					lexem.type = BIN_CONST;
-					lexem.text.pop_back();
-				} else if (tolower(input[i]) == 'h') {
-					lexem.type = HEX_CONST;
-					i++;
-				} else {
-					if (tolower(input[i]) == 'd') i++;
-					lexem.type = DEC_CONST;
-				}
-			} else if (input[i] == '\'') {
-				i++;
-				while ((i < input.size()) && (input[i] != '\'')) {
-					lexem.text += input[i++];
-				}
-				i++;
-				lexem.type = STR_CONST;
-			} else if (isonechar(input[i])) {
-				lexem.text = input[i++];
-				lexem.type = ONE_CHAR;
-			} else i++;
-
-			if (lexem.type == USER_IDENT) {
-				map<string, Symbol>::iterator equ = symbol_table.find(lexem.text);
-				if ((equ != symbol_table.end()) && (equ->second.type == -3)) {
-					lexem.type = DEC_CONST;
-					lexem.text = to_string(equ->second.value);
-				}
-			}
+	Lexer lexer(stage1, input);
+	Token token;
+	for (int index = 0; lexer.next(token);) {
+		Lexem lexem;
+		lexem.index = index++;
+		lexem.type = lexemType(token);
+		lexem.text = string(token.text);
+		lexem.term = Term::of(token, token.keyword == -1 ? 0 : stage1.keywords[token.keyword].code);
+		if (token.type != Token::String) {
+			for (char &c : lexem.text) c = stage1.fold(c);
+		}
 
-			lexems.push_back(lexem);
+		if (lexem.type == USER_IDENT) {
+			map<string, Symbol>::iterator equ = symbol_table.find(lexem.text);
+			if ((equ != symbol_table.end()) && (equ->second.type == -3)) {
+				lexem.type = DEC_CONST;
+				lexem.text = to_string(equ->second.value);
+				lexem.term = Term(Term::Number, 0, equ->second.value);
+			}
 		}
+
+		lexems.push_back(lexem);
 	}
 	return lexems;
 }
@@ -386,12 +301,12 @@ int GetSizeOfIMM(int type, int imm) {
 	return ((-128 <= imm) && (imm < 128)) ? 1 : 4;
 }
 
-string GetDefRegSeg(const Lexem &reg) {
-	string text = reg.text;
-	if ((text.compare("esp") == 0) || (text.compare("ebp") == 0) || (text.compare("sp") == 0) || (text.compare("bp") == 0)) 
-		return "ss";
-	else if (reg.type == LexemType::REG_32) return "ds";
-	return "";
+// Segment register an address through reg defaults to, -1 for none.
+int GetDefRegSeg(const Register &reg) {
+	if (reg.is(Term::Reg32, code("ESP")) || reg.is(Term::Reg32, code("EBP"))) 
+		return code("SS");
+	else if (reg.type == Term::Reg32) return code("DS");
+	return -1;
 }
 
 void FirstView::run(const string &filepath) {
@@ -412,30 +327,30 @@ void FirstView::run(const string &filepath) {
 		this->sentence = &sentence;
 		printed = false;
 
-		if (sentence.label.size() == 2) {
+		if (sentence.colon) {
 			Symbol symbol;
 			symbol.type = -1;
 			symbol.value = offset;
 			symbol.segment = segment;
-			symbol_table[sentence.label[0].text] = symbol;
+			symbol_table[sentence.lexems[sentence.label].text] = symbol;
 			printOffset();
 		}
 
-		if (!sentence.mnemocode.empty()) {
-			if (sentence.mnemocode[0].text.compare("if") == 0) {
+		if (sentence.mnemo != -1) {
+			if (sentence.mnemocode().text.compare("if") == 0) {
 				IF context;
 				context.value = sentence.operands[0].imm;
 				ifTable.push_back(context);
 				if (!context.value) continue;
-			} else if (sentence.mnemocode[0].text.compare("else") == 0) {
+			} else if (sentence.mnemocode().text.compare("else") == 0) {
 				IF &context = ifTable.back();
 				context.value = !context.value;
 				if (!context.value) continue;
-			} else if (sentence.mnemocode[0].text.compare("endif") == 0) { 
+			} else if (sentence.mnemocode().text.compare("endif") == 0) { 
 				ifTable.pop_back();
 			} else if (!ifTable.empty() && !ifTable.back().value) {
 				continue;
-			} else if (sentence.mnemocode[0].text.compare("equ") == 0) {
+			} else if (sentence.mnemocode().text.compare("equ") == 0) {
 				fprintf(outfile, " = ");
 				Symbol symbol;
 				symbol.type = -3;
@@ -444,59 +359,59 @@ void FirstView::run(const string &filepath) {
 					symbol.value = sentence.operands[0].imm;	
 					fprintf(outfile, "%.4X", symbol.value);
 				// } else symbol.value = 0;
-				symbol_table[sentence.label[0].text] = symbol;
-			} else if (sentence.mnemocode[0].text.compare("assume") == 0) {
+				symbol_table[sentence.lexems[sentence.label].text] = symbol;
+			} else if (sentence.mnemocode().text.compare("assume") == 0) {
 				for (Operand &operand : sentence.operands) {
-					assume_table[operand.sreg] = operand.ident;
+					assume_table[operand.sreg.code] = sentence.name(operand);
 				}
-			} else if (sentence.mnemocode[0].text.compare("segment") == 0) {
+			} else if (sentence.mnemocode().text.compare("segment") == 0) {
 				offset = 0;
 				printOffset();
-				if (sentence.label.size() == 1)
-					segment = sentence.label[0].text;
-			} else if (sentence.mnemocode[0].text.compare("ends") == 0) {
+				if ((sentence.label != -1) && !sentence.colon)
+					segment = sentence.lexems[sentence.label].text;
+			} else if (sentence.mnemocode().text.compare("ends") == 0) {
 				printOffset();
 				segment_table[segment] = offset;
 				offset = 0;
 				segment.clear();
-			} else if (sentence.mnemocode[0].text.compare("end") == 0) {
-			} else if (sentence.mnemocode[0].type == DATA_TYPE) {
+			} else if (sentence.mnemocode().text.compare("end") == 0) {
+			} else if (sentence.mnemocode().type == DATA_TYPE) {
 				printOffset();
 				Symbol symbol;
 				symbol.value = offset;
 				symbol.segment = segment;
 
-				if (sentence.mnemocode[0].text.compare("db") == 0) {
+				if (sentence.mnemocode().text.compare("db") == 0) {
 					symbol.type = 1;
-					if (!sentence.operands[0].text.empty()) {
-						sentence.length = sentence.operands[0].text.size();
+					if (!sentence.str(sentence.operands[0]).empty()) {
+						sentence.length = sentence.str(sentence.operands[0]).size();
 					} else sentence.length = 1; 
-				} else if (sentence.mnemocode[0].text.compare("dw") == 0) {
+				} else if (sentence.mnemocode().text.compare("dw") == 0) {
 					symbol.type = 2;
 					sentence.length = 2;
-				} else if (sentence.mnemocode[0].text.compare("dd") == 0) {
+				} else if (sentence.mnemocode().text.compare("dd") == 0) {
 					symbol.type = 4;
 					sentence.length = 4;
 				} 
 
-				if (sentence.label.size() == 1)
-					symbol_table[sentence.label[0].text] = symbol;
+				if ((sentence.label != -1) && !sentence.colon)
+					symbol_table[sentence.lexems[sentence.label].text] = symbol;
 			} else {
 				printOffset();
-				if (sentence.mnemocode[0].text.compare("pusha") == 0) {
+				if (sentence.mnemocode().text.compare("pusha") == 0) {
 					sentence.length = 2;
-				} else if (sentence.mnemocode[0].text.compare("inc") == 0) {
+				} else if (sentence.mnemocode().text.compare("inc") == 0) {
 					if (sentence.operands.size() > 0) {
-						LexemType &reg = sentence.operands[0].reg.type;
-						if (reg == LexemType::REG_8) sentence.length = 2;
-						else if (reg == LexemType::REG_32) sentence.length = 1;
+						Term::Class reg = sentence.operands[0].reg.type;
+						if (reg == Term::Reg8) sentence.length = 2;
+						else if (reg == Term::Reg32) sentence.length = 1;
 					}
-				} else if (sentence.mnemocode[0].text.compare("dec") == 0) {
+				} else if (sentence.mnemocode().text.compare("dec") == 0) {
 					if (sentence.operands.size() > 0) {
-						string sreg = sentence.operands[0].sreg;
-						Lexem &base = sentence.operands[0].base;
-						Lexem &index = sentence.operands[0].index;
-						string ident = sentence.operands[0].ident;
+						Register &sreg = sentence.operands[0].sreg;
+						Register &base = sentence.operands[0].base;
+						Register &index = sentence.operands[0].index;
+						string ident = sentence.name(sentence.operands[0]);
 						int disp = sentence.operands[0].disp;
 
 						sentence.length = 3;// + GetSizeOfIMM(sentence.operands[0].ptr, sentence.operands[0].disp & 0xFFFFFFFF);
@@ -509,38 +424,38 @@ void FirstView::run(const string &filepath) {
 							sentence.length += 4;
 						} else sentence.length += 1;
 						
-						if (!sreg.empty() && (sentence.operands[0].sreg.compare(GetDefRegSeg(base)) != 0)) {
+						if (sreg.present() && (sreg.code != GetDefRegSeg(base))) {
 							sentence.length += 1;
-						} else if ((base.type != LexemType::UNKNOWN) && (GetDefRegSeg(base).compare("ds") != 0)) {
+						} else if (base.present() && (GetDefRegSeg(base) != code("DS"))) {
 							sentence.length += 1;
 						} else {
 							Symbol symbol = symbol_table[ident];
 							for (auto &assume : assume_table) {
 								if (assume.second.compare(symbol.segment) == 0) {
-									if (assume.first.compare("ds") != 0) {
+									if (assume.first != code("DS")) {
 										sentence.length += 1;
 									}
 								}
 							}
 						}
 
-						if ((base.text.compare("esi") == 0) || (base.text.compare("edi") == 0) || (index.text.compare("esi") == 0) || (index.text.compare("edi") == 0)) {
+						if (base.is(Term::Reg32, code("ESI")) || base.is(Term::Reg32, code("EDI")) || index.is(Term::Reg32, code("ESI")) || index.is(Term::Reg32, code("EDI"))) {
 							sentence.length += 1;
 						}
 					}
-				} else if (sentence.mnemocode[0].text.compare("xchg") == 0) {
+				} else if (sentence.mnemocode().text.compare("xchg") == 0) {
 					if (sentence.operands.size() > 1) {
-						if ((sentence.operands[0].reg.type == LexemType::REG_32) && (sentence.operands[1].reg.type == LexemType::REG_32)) {
+						if ((sentence.operands[0].reg.type == Term::Reg32) && (sentence.operands[1].reg.type == Term::Reg32)) {
 							sentence.length = 1;
-							if (sentence.operands[1].reg.text.compare("eax") != 0) sentence.length += 1;
+							if (!sentence.operands[1].reg.is(Term::Reg32, code("EAX"))) sentence.length += 1;
 						}						
 					}
-				} else if (sentence.mnemocode[0].text.compare("lea") == 0) {
+				} else if (sentence.mnemocode().text.compare("lea") == 0) {
 					if (sentence.operands.size() > 1) {
-						string sreg = sentence.operands[0].sreg;
-						Lexem &base = sentence.operands[0].base;
-						Lexem &index = sentence.operands[0].index;
-						string ident = sentence.operands[0].ident;
+						Register &sreg = sentence.operands[0].sreg;
+						Register &base = sentence.operands[0].base;
+						Register &index = sentence.operands[0].index;
+						string ident = sentence.name(sentence.operands[0]);
 						int disp = sentence.operands[0].disp;
 
 						sentence.length = 3;// + GetSizeOfIMM(sentence.operands[0].ptr, sentence.operands[0].disp & 0xFFFFFFFF);
@@ -553,27 +468,27 @@ void FirstView::run(const string &filepath) {
 							sentence.length += 4;
 						} else sentence.length += 1;
 
-						if (!sreg.empty() && (sentence.operands[0].sreg.compare(GetDefRegSeg(base)) != 0)) {
+						if (sreg.present() && (sreg.code != GetDefRegSeg(base))) {
 							sentence.length += 1;
-						} else if ((base.type != LexemType::UNKNOWN) && (GetDefRegSeg(base).compare("ds") != 0)) {
+						} else if (base.present() && (GetDefRegSeg(base) != code("DS"))) {
 							sentence.length += 1;
 						} else {
 							Symbol symbol = symbol_table[ident];
 							for (auto &assume : assume_table) {
 								if (assume.second.compare(symbol.segment) == 0) {
-									if (assume.first.compare("ds") != 0) {
+									if (assume.first != code("DS")) {
 										sentence.length += 1;
 									}
 								}
 							}
 						}
 					}
-				} else if (sentence.mnemocode[0].text.compare("and") == 0) {
+				} else if (sentence.mnemocode().text.compare("and") == 0) {
 					if (sentence.operands.size() > 1) {
-						string sreg = sentence.operands[0].sreg;
-						Lexem &base = sentence.operands[0].base;
-						Lexem &index = sentence.operands[0].index;
-						string ident = sentence.operands[0].ident;
+						Register &sreg = sentence.operands[0].sreg;
+						Register &base = sentence.operands[0].base;
+						Register &index = sentence.operands[0].index;
+						string ident = sentence.name(sentence.operands[0]);
 						int disp = sentence.operands[0].disp;
 
 						sentence.length = 3;// + GetSizeOfIMM(sentence.operands[0].ptr, sentence.operands[0].disp & 0xFFFFFFFF);
@@ -586,36 +501,36 @@ void FirstView::run(const string &filepath) {
 							sentence.length += 4;
 						} else sentence.length += 1;
 
-						if (!sreg.empty() && (sentence.operands[0].sreg.compare(GetDefRegSeg(base)) != 0)) {
+						if (sreg.present() && (sreg.code != GetDefRegSeg(base))) {
 							sentence.length += 1;
-						} else if ((base.type != LexemType::UNKNOWN) && (GetDefRegSeg(base).compare("ds") != 0)) {
+						} else if (base.present() && (GetDefRegSeg(base) != code("DS"))) {
 							sentence.length += 1;
 						} else {
 							Symbol symbol = symbol_table[ident];
 							for (auto &assume : assume_table) {
 								if (assume.second.compare(symbol.segment) == 0) {
-									if (assume.first.compare("ds") != 0) {
+									if (assume.first != code("DS")) {
 										sentence.length += 1;
 									}
 								}
 							}
 						}
 
-						if ((base.text.compare("esi") == 0) || (base.text.compare("edi") == 0) || (index.text.compare("esi") == 0) || (index.text.compare("edi") == 0)) {
+						if (base.is(Term::Reg32, code("ESI")) || base.is(Term::Reg32, code("EDI")) || index.is(Term::Reg32, code("ESI")) || index.is(Term::Reg32, code("EDI"))) {
 							sentence.length += 1;
 						}
 					}
-				} else if (sentence.mnemocode[0].text.compare("mov") == 0) {
+				} else if (sentence.mnemocode().text.compare("mov") == 0) {
 					if (sentence.operands.size() > 1) {
-						int reg = (sentence.operands[0].reg.type == LexemType::REG_8) ? 1 : ((sentence.operands[0].reg.type == LexemType::REG_32) ? 4 : 0);
+						int reg = (sentence.operands[0].reg.type == Term::Reg8) ? 1 : ((sentence.operands[0].reg.type == Term::Reg32) ? 4 : 0);
 						sentence.length = 1 + reg;
 					}
-				} else if (sentence.mnemocode[0].text.compare("or") == 0) {
+				} else if (sentence.mnemocode().text.compare("or") == 0) {
 					if (sentence.operands.size() > 1) {
-						string sreg = sentence.operands[0].sreg;
-						Lexem &base = sentence.operands[0].base;
-						Lexem &index = sentence.operands[0].index;
-						string ident = sentence.operands[0].ident;
+						Register &sreg = sentence.operands[0].sreg;
+						Register &base = sentence.operands[0].base;
+						Register &index = sentence.operands[0].index;
+						string ident = sentence.name(sentence.operands[0]);
 						int disp = sentence.operands[0].disp;
 
 						sentence.length = 3 + GetSizeOfIMM(sentence.operands[0].ptr, sentence.operands[0].imm & 0xFFFFFFFF);
@@ -628,28 +543,28 @@ void FirstView::run(const string &filepath) {
 							sentence.length += 4;
 						} else sentence.length += 1;
 
-						if (!sreg.empty() && (sentence.operands[0].sreg.compare(GetDefRegSeg(base)) != 0)) {
+						if (sreg.present() && (sreg.code != GetDefRegSeg(base))) {
 							sentence.length += 1;
-						} else if ((base.type != LexemType::UNKNOWN) && (GetDefRegSeg(base).compare("ds") != 0)) {
+						} else if (base.present() && (GetDefRegSeg(base) != code("DS"))) {
 							sentence.length += 1;
 						} else {
 							Symbol symbol = symbol_table[ident];
 							for (auto &assume : assume_table) {
 								if (assume.second.compare(symbol.segment) == 0) {
-									if (assume.first.compare("ds") != 0) {
+									if (assume.first != code("DS")) {
 										sentence.length += 1;
 									}
 								}
 							}
 						}
 
-						if ((base.text.compare("esi") == 0) || (base.text.compare("edi") == 0) || (index.text.compare("esi") == 0) || (index.text.compare("edi") == 0)) {
+						if (base.is(Term::Reg32, code("ESI")) || base.is(Term::Reg32, code("EDI")) || index.is(Term::Reg32, code("ESI")) || index.is(Term::Reg32, code("EDI"))) {
 							sentence.length += 1;
 						}
 					}
-				} else if (sentence.mnemocode[0].text.compare("jb") == 0) {
+				} else if (sentence.mnemocode().text.compare("jb") == 0) {
 					if (sentence.operands.size() > 0) {
-						string ident = sentence.operands[0].ident;
+						string ident = sentence.name(sentence.operands[0]);
 
 						if (ident.empty()) {
 							printf("Illegal operand type at line %d", current_line);
@@ -666,8 +581,8 @@ void FirstView::run(const string &filepath) {
 		}
 		sentence.offset = offset;
 		offset += sentence.length;
-		sentences.push_back(sentence);	
 		fprintf(outfile, "\t\t%s\n", sentence.input.c_str());
+		sentences.push_back(move(sentence));
 
 	}
 	file.close();
@@ -695,12 +610,12 @@ void FirstView::printLexical() {
 		fprintf(file, " Мітка   Мнемокод    1-ий операнд      2-ий операнд\n");
 		fprintf(file, " індекс   індекс   індекс кількість  індекс кількість\n");
 
-		int label = sentence.label.empty() ? -1 : (sentence.label[0].index + 1);
-		int mnemo = sentence.mnemocode.empty() ? -1 : (sentence.mnemocode[0].index + 1);
-		int o1index = sentence.operands.size() > 0 ? (sentence.operands[0].lexems[0].index + 1) : -1;
-		int o1count = sentence.operands.size() > 0 ? sentence.operands[0].lexems.size() : 0;
-		int o2index = sentence.operands.size() > 1 ? (sentence.operands[1].lexems[0].index + 1) : -1;
-		int o2count = sentence.operands.size() > 1 ? sentence.operands[1].lexems.size(): 0;
+		int label = sentence.label == -1 ? -1 : (sentence.label + 1);
+		int mnemo = sentence.mnemo == -1 ? -1 : (sentence.mnemo + 1);
+		int o1index = sentence.operands.size() > 0 ? (sentence.operands[0].first + 1) : -1;
+		int o1count = sentence.operands.size() > 0 ? sentence.operands[0].count : 0;
+		int o2index = sentence.operands.size() > 1 ? (sentence.operands[1].first + 1) : -1;
+		int o2count = sentence.operands.size() > 1 ? sentence.operands[1].count : 0;
 		fprintf(file, " %6i  %8i  %6i %9i  %6i %9i\n\n", label, mnemo, o1index, o1count, o2index, o2count);	
 		int index = 0;
 		for (Lexem &lexem : sentence.lexems) {
@@ -6,106 +6,67 @@ using namespace std;
 #include <vector>
 #include <map>
 
-bool IsOneChar(const string &str) {
-	return (str.compare("+") == 0) || (str.compare(":") == 0) || (str.compare(",") == 0) || (str.compare("[") == 0) || (str.compare("]") == 0);
-}
-
-bool IsReg8(const string &str) {
-	return (str.compare("AH") == 0) || (str.compare("BH") == 0) || (str.compare("CH") == 0) || (str.compare("DH") == 0) || (str.compare("AL") == 0) || (str.compare("BL") == 0) || (str.compare("CL") == 0) || (str.compare("DL") == 0);
-}
-
-bool IsReg16(const string &str) {
-	return (str.compare("AX") == 0) || (str.compare("BX") == 0) || (str.compare("CX") == 0) || (str.compare("DX") == 0) || (str.compare("SI") == 0) || (str.compare("DI") == 0) || (str.compare("SP") == 0) || (str.compare("BP") == 0);
-}
-
-bool IsSReg(const string &str) {
-	return (str.compare("CS") == 0) || (str.compare("DS") == 0) || (str.compare("SS") == 0) || (str.compare("ES") == 0) || (str.compare("FS") == 0) || (str.compare("GS") == 0);
-}
+#include "../common/dialects.h"
 
-bool IsDataType(const string &str) {
-	return (str.compare("DB") == 0) || (str.compare("DW") == 0);
+// Index of a keyword, for comparing against Lexem::keyword.
+constexpr int keyword(const char *text) {
+	return stage2.keywords.find(text);
 }
 
-bool IsPtrType(const string &str) {
-	return (str.compare("FAR") == 0) || (str.compare("BYTE") == 0) || (str.compare("DWORD") == 0);
-}
+// A token classified once by the lexer: its kind, the keyword it names and
+// that keyword's code (register number, data or pointer size).
+struct Lexem {
+	Token::Type type;
+	int keyword, code;
+	long value;
+	string text;
 
-bool IsPtrPtr(const string &str) {
-	return str.compare("PTR") == 0;
-}
-
-bool IsDirective(const string &str) {
-	return (str.compare("END") == 0) || (str.compare("SEGMENT") == 0) || (str.compare("ENDS") == 0) || (str.compare("PROC") == 0) || (str.compare("ENDP") == 0) || (str.compare("ASSUME") == 0);
-}
-
-bool IsCommand(const string &str) {
-	return (str.compare("RET") == 0) || (str.compare("NOT") == 0) || (str.compare("OR") == 0) || (str.compare("ADD") == 0) || (str.compare("MOV") == 0) || (str.compare("JGE") == 0) || (str.compare("CALL") == 0);
-}
-
-bool IsNumber(const string &str) {
-	return isdigit(str.front());
-}
-
-bool IsString(const string &str) {
-	return str.front() == '\'';
-}
+	bool is(Token::Type type) const {
+		return this->type == type;
+	}
 
-bool IsReserved(const string &str) {
-	return IsReg8(str) || IsReg16(str) || IsSReg(str) || IsDataType(str) || IsPtrType(str) || IsPtrPtr(str) || IsDirective(str) || IsCommand(str);
-}
+	bool is(const char *text) const {
+		return (type == Token::OneChar) && (this->text.compare(text) == 0);
+	}
 
-bool IsIdentifier(const string &str) {
-	return isalpha(str.front()) && !IsReserved(str);
-}
+	bool isRegister() const {
+		return (type == Token::Reg8) || (type == Token::Reg16);
+	}
+};
 
-string getLexemInfo(const string &str) {
-	if (IsString(str)) return "string";
-	else if (IsNumber(str)) return "number";
-	else if (IsString(str)) return "string";
-	else if (IsOneChar(str)) return "one char";
-	else if (IsDataType(str)) return "data type";
-	else if (IsPtrType(str)) return "ptr type";
-	else if (IsPtrPtr(str)) return "ptr operator";
-	else if (IsReg8(str)) return "8-bit register";
-	else if (IsReg16(str)) return "16-bit register";
-	else if (IsSReg(str)) return "segment register";
-	else if (IsCommand(str)) return "command";
-	else if (IsDirective(str)) return "directive";
-	else if (IsIdentifier(str)) return "identifier";
-	else return "unknown";
+string getLexemInfo(const Lexem &lexem) {
+	switch (lexem.type) {
+		case Token::String: return "string";
+		case Token::Number: return "number";
+		case Token::OneChar: return "one char";
+		case Token::DataType: return "data type";
+		case Token::PtrType: return "ptr type";
+		case Token::Operator: return "ptr operator";
+		case Token::Reg8: return "8-bit register";
+		case Token::Reg16: return "16-bit register";
+		case Token::SReg: return "segment register";
+		case Token::Command: return "command";
+		case Token::Directive: return "directive";
+		case Token::Identifier: return "identifier";
+		default: return "unknown";
+	}
 }
 
-vector<string> divide(const string &str) {
-	vector<string> lexems;
-	int i = 0, index = 0;
-	while (i < str.size()) {
-		if (str[i] == ';') break;
-		else if (isspace(str[i])) i++;
-		else {
-			string text;
-			if (isalpha(str[i])) {
-				while ((i < str.size()) && isalnum(str[i])) {
-					text += toupper(str[i++]);
-				}
-			} else if (isdigit(str[i])) {
-				while ((i < str.size()) && isxdigit(str[i])) {
-					text += toupper(str[i++]);
-				}
-				if (toupper(str[i]) == 'H') {
-					text += toupper(str[i++]);
-				}
-			} else if (str[i] == '\'') {
-				text += str[i++];
-				while ((i < str.size()) && (str[i] != '\'')) {
-					text += str[i++];
-				}
-				text += str[i++];
-			} else if (!IsOneChar(text = str[i++])) {
-				text = "";
-			}
-
-			lexems.push_back(text);
+vector<Lexem> divide(const string &str) {
+	vector<Lexem> lexems;
+	Lexer lexer(stage2, str);
+	Token token;
+	while (lexer.next(token)) {
+		Lexem lexem;
+		lexem.type = token.type;
+		lexem.keyword = token.keyword;
+		lexem.code = token.keyword == -1 ? 0 : stage2.keywords[token.keyword].code;
+		lexem.value = token.value;
+		lexem.text = string(token.text);
+		if (token.type != Token::String) {
+			for (char &c : lexem.text) c = stage2.fold(c);
 		}
+		lexems.push_back(lexem);
 	}
 	return lexems;
 }
@@ -116,83 +77,104 @@ struct Symbol {
 };
 
 struct Operand {
-	vector<string> lexems;
-
-	struct Table {
-		bool present;
-		string first, second;
-	} table[10];
-
-	Operand(const vector<string> &lexems) {
-		this->lexems = lexems;
-
-		int i = 0;
-		if ((i < lexems.size()) && IsPtrType(lexems[i])) {
-			string ptr = lexems[i++];
-			if ((i < lexems.size()) && IsPtrPtr(lexems[i])) {
+	vector<Lexem> lexems;
+
+	// Each part is present when its lexem index is not -1. ptr is the size
+	// code of a "type PTR" prefix (-2 for FAR), 0 without one.
+	int reg, sreg, ident, base, index, str;
+	int ptr, scale;
+	long imm, disp;
+	bool hasImm, hasDisp;
+
+	Operand(const vector<Lexem> &lexems) : lexems(lexems), reg(-1), sreg(-1), ident(-1), base(-1), index(-1), str(-1), ptr(0), scale(0), imm(0), disp(0), hasImm(false), hasDisp(false) {
+		int i = 0, len = lexems.size();
+		if ((i < len) && lexems[i].is(Token::PtrType)) {
+			int ptr = lexems[i++].code;
+			if ((i < len) && lexems[i].is(Token::Operator)) {
 				i++;
-				if (ptr.compare("FAR") == 0) {
-					this->ptr = -2;
-				} else if (ptr.compare("BYTE") == 0) {
-					this->ptr = 1;
-				} else if (ptr.compare("WORD") == 0) {
-					this->ptr = 2;
-				}
+				this->ptr = ptr;
 			}
 		}
 
-		if (i < lexems.size()) {
-			if (IsReg8(lexems[i]) || IsReg16(lexems[i])) {
-				reg = lexems[i++];
-			} else if (IsNumber(lexems[i])) {
-				imm = stol(lexems[i++], 0, 16);
-			} else if (IsString(lexems[i])) {
-				str = lexems[i++];
+		if (i < len) {
+			if (lexems[i].isRegister()) {
+				reg = i++;
+			} else if (lexems[i].is(Token::Number)) {
+				hasImm = true;
+				imm = lexems[i++].value;
+			} else if (lexems[i].is(Token::String)) {
+				str = i++;
 			}
 		}
 
-		if ((i < lexems.size()) && IsSReg(lexems[i])) {
-			string sreg = lexems[i++];
-			if ((i < lexems.size()) && lexems[i].compare(":") == 0) {
-				i++;
-				sreg = sreg;
+		if ((i < len) && lexems[i].is(Token::SReg)) {
+			if ((i + 1 < len) && lexems[i + 1].is(":")) {
+				sreg = i;
+				i += 2;
 			}
 		}
 
-		if ((i < lexems.size()) && IsIdentifier(lexems[i])) {
-			ident = lexems[i++];
+		if ((i < len) && lexems[i].is(Token::Identifier)) {
+			ident = i++;
 		}
 
-		if ((i < lexems.size()) && (lexems[i].compare("[") == 0)) {
+		if ((i < len) && lexems[i].is("[")) {
 			i++;
-			if ((i < lexems.size()) && IsReg16(lexems[i])) {
-				base = lexems[i++];
-				if ((i < lexems.size()) && (lexems[i].compare("+") == 0)) {
+			if ((i < len) && lexems[i].is(Token::Reg16)) {
+				base = i++;
+				if ((i < len) && lexems[i].is("+")) {
 					i++;
-					if ((i < lexems.size()) && IsReg16(lexems[i])) {
-						index = lexems[i++];
+					if ((i < len) && lexems[i].is(Token::Reg16)) {
+						index = i++;
 						scale = 1;
-						if ((i < lexems.size()) && (lexems[i].compare("+") == 0)) {
+						if ((i < len) && lexems[i].is("+")) {
 							i++;
-							if ((i < lexems.size()) && IsNumber(lexems[i])) {
-								disp = stol(lexems[i++], 0, 16);
+							if ((i < len) && lexems[i].is(Token::Number)) {
+								hasDisp = true;
+								disp = lexems[i++].value;
 							}
 						}
 					}
 				}
 			}
-			if ((i < lexems.size()) && (lexems[i].compare("]") == 0)) {
+			if ((i < len) && lexems[i].is("]")) {
 				i++;
 			}
 		}
 	}
+
+	const Lexem &Get(int part) const {
+		return lexems[part];
+	}
+
+	bool IsRegister() const {
+		return (reg != -1) && (ident == -1) && (base == -1);
+	}
+
+	bool IsImmediate() const {
+		return hasImm && (reg == -1) && (ident == -1) && (base == -1);
+	}
+
+	bool IsMemory() const {
+		return (reg == -1) && !hasImm && (str == -1) && ((ident != -1) || (base != -1));
+	}
+
+	bool IsIdentifier() const {
+		return (ident != -1) && (reg == -1) && (base == -1);
+	}
+
+	// A segment override other than the default DS.
+	bool IsForeignSegment() const {
+		return (sreg != -1) && (lexems[sreg].keyword != keyword("DS"));
+	}
 };
 
 struct Sentence {
-	string label, ident, mnemo;
+	string label, ident;
+	int mnemo;
 	vector<Operand> operands;
 	unsigned length, offset;
-	vector<string> lexems;
+	vector<Lexem> lexems;
 	string text, bytes;
 	bool printed;
 
@@ -202,24 +184,25 @@ struct Sentence {
 		this->printed = false;
 		this->length = 0;
 		this->offset = 0;
+		this->mnemo = -1;
 
 		int i = 0;
-		if ((i < lexems.size()) && IsIdentifier(lexems[i])) {
-			string str = lexems[i++];
-			if ((i < lexems.size()) && (lexems[i].compare(":") == 0)) {
+		if ((i < lexems.size()) && lexems[i].is(Token::Identifier)) {
+			string str = lexems[i++].text;
+			if ((i < lexems.size()) && lexems[i].is(":")) {
 				label = str;
 				i++;
 			} else ident = str;
 		}
 
-		if ((i < lexems.size()) && (IsDirective(lexems[i]) || IsCommand(lexems[i]) || IsDataType(lexems[i]))) {
-			mnemo = lexems[i++];
+		if ((i < lexems.size()) && (lexems[i].is(Token::Directive) || lexems[i].is(Token::Command) || lexems[i].is(Token::DataType))) {
+			mnemo = lexems[i++].keyword;
 		}
 
 		while ((i < lexems.size())) {
-			vector<string> operand;
+			vector<Lexem> operand;
 			while (i < lexems.size()) {
-				if (lexems[i].compare(",") == 0) {
+				if (lexems[i].is(",")) {
 					i++; 
 					break;
 				}
@@ -229,6 +212,10 @@ struct Sentence {
 		}
 	}
 
+	bool IsDataType() const {
+		return (mnemo != -1) && (stage2.keywords[mnemo].type == Token::DataType);
+	}
+
 	void Print(FILE *file) {
 		if (text.empty()) return;
 		fprintf(file, "text: %s\n", text.c_str());
@@ -237,16 +224,16 @@ struct Sentence {
 		fprintf(file, " index    index    index count  index count\n");
 
 		int index = 0;
-		int label_index = (IsIdentifier(label) || IsIdentifier(ident)) ? ++index : -1;
-		int mnemo_index = (IsDirective(mnemo) || IsCommand(mnemo) || IsDataType(mnemo))  ? ++index : -1;
+		int label_index = (!label.empty() || !ident.empty()) ? ++index : -1;
+		int mnemo_index = (mnemo != -1) ? ++index : -1;
 		int op1_index = (operands.size() > 0) ? ++index : -1;
 		int op1_count = (operands.size() > 0) ? operands[0].lexems.size() : 0;
 		int op2_index = (operands.size() > 1) ? (op1_index + op1_count) : -1;
 		int op2_count = (operands.size() > 1) ? operands[1].lexems.size() : 0;
 		fprintf(file, " %5i  %9i  %5i %5i  %5i %5i\n\n", label_index, mnemo_index, op1_index, op1_count, op2_index, op2_count);	
 		index = 0;
-		for (string &lexem : lexems) {
-			fprintf(file, "%-2d | %11s | %2i | %16s |\n", ++index, lexem.c_str(), lexem.size(), getLexemInfo(lexem).c_str());
+		for (Lexem &lexem : lexems) {
+			fprintf(file, "%-2d | %11s | %2i | %16s |\n", ++index, lexem.text.c_str(), (int)lexem.text.size(), getLexemInfo(lexem).c_str());
 		}
 		fprintf(file, "\n");
 	}
@@ -276,6 +263,7 @@ void View::Parse(const string &path) {
 
 	ifstream file(path);
 	ds = "DS";
+	offset = 0;
 
 	string line;
 	while (getline(file, line)) {
@@ -290,24 +278,24 @@ void View::Parse(const string &path) {
 			sentence.printed = true;
 		}
 
-		if (!sentence.mnemo.empty()) {
-			if (sentence.mnemo.compare("END") == 0) {
+		if (sentence.mnemo != -1) {
+			if (sentence.mnemo == keyword("END")) {
 
-			} else if (sentence.mnemo.compare("SEGMENT") == 0) {
+			} else if (sentence.mnemo == keyword("SEGMENT")) {
 				sentence.printed = true;
 				segment = sentence.ident;
 				offset = 0;
-			} else if (sentence.mnemo.compare("ENDS") == 0) {
+			} else if (sentence.mnemo == keyword("ENDS")) {
 				sentence.printed = true;
 				segmentsTable[segment] = offset;
 				segment.clear();
-			} else if (sentence.mnemo.compare("PROC") == 0) {
+			} else if (sentence.mnemo == keyword("PROC")) {
 				sentence.printed = true;
 				Symbol symbol;
 
 				symbol.type = "N PROC";
 				if (!sentence.operands.empty()) {
-					if (sentence.operands[0].lexems[0].compare("FAR") == 0) {
+					if (!sentence.operands[0].lexems.empty() && (sentence.operands[0].lexems[0].keyword == keyword("FAR"))) {
 						symbol.type = "F PROC";
 					}
 				}
@@ -316,30 +304,32 @@ void View::Parse(const string &path) {
 				if (!sentence.ident.empty()) {
 					symbolsTable[sentence.ident] = symbol;
 				}
-			} else if (sentence.mnemo.compare("ENDP") == 0) {
+			} else if (sentence.mnemo == keyword("ENDP")) {
 				sentence.printed = true;
 				if (!sentence.ident.empty()) {
 					char buf[14] = {0};
 					sprintf(buf, "Length = %.4X", offset - symbolsTable[sentence.ident].offset);
 					symbolsTable[sentence.ident].attr = '\t' + string(buf);
 				}
-			} else if (sentence.mnemo.compare("ASSUME") == 0) {
+			} else if (sentence.mnemo == keyword("ASSUME")) {
 				for (Operand &operand : sentence.operands) {
-					assume_table[operand.Get(2).first] = operand.Get(4).first;
+					if ((operand.sreg != -1) && (operand.ident != -1)) {
+						assume_table[operand.Get(operand.sreg).text] = operand.Get(operand.ident).text;
+					}
 				}
-			} else if (IsDataType(sentence.mnemo)) {
+			} else if (sentence.IsDataType()) {
 				sentence.printed = true;
 
 				Symbol symbol;
 				symbol.offset = offset;
 				symbol.segment = segment;
 
-				if (sentence.mnemo.compare("DB") == 0) {
+				if (sentence.mnemo == keyword("DB")) {
 					symbol.type = "L BYTE";
-					if (IsString(sentence.operands[0].Get(9).first)) {
-						sentence.length = sentence.operands[0].Get(9).first.size() - 2;
+					if (!sentence.operands.empty() && (sentence.operands[0].str != -1)) {
+						sentence.length = sentence.operands[0].Get(sentence.operands[0].str).text.size() - 2;
 					} else sentence.length = 1; 
-				} else if (sentence.mnemo.compare("DW") == 0) {
+				} else if (sentence.mnemo == keyword("DW")) {
 					symbol.type = "L WORD";
 					sentence.length = 2;
 				}
@@ -349,21 +339,21 @@ void View::Parse(const string &path) {
 			} else {
 				sentence.printed = true;
 
-				if (sentence.mnemo.compare("RET") == 0) {
+				if (sentence.mnemo == keyword("RET")) {
 					sentence.length = 1;
-				} else if (sentence.mnemo.compare("NOT") == 0) {
+				} else if (sentence.mnemo == keyword("NOT")) {
 					if (sentence.operands.size() > 0) {
 						if (sentence.operands[0].IsRegister()) {
 							sentence.length = 2;
 						}
 					}
-				} else if (sentence.mnemo.compare("OR") == 0) {
+				} else if (sentence.mnemo == keyword("OR")) {
 					if (sentence.operands.size() > 1) {
 						if (sentence.operands[0].IsRegister() && sentence.operands[1].IsMemory()) {
 							 sentence.length = 2;
 
-							if (sentence.operands[1].Get(8).present) {
-								long number = stol(sentence.operands[1].Get(8).first, 0, 16);
+							if (sentence.operands[1].hasDisp) {
+								long number = sentence.operands[1].disp;
 								if (number != 0) {
 									if ((number >= -128) && (number <= 127)) {
 										sentence.length += 1;
@@ -373,83 +363,87 @@ void View::Parse(const string &path) {
 								}
 							}
 
-							if (sentence.operands[1].Get(2).present) {
-								if (sentence.operands[1].Get(2).first.compare("ds") != 0) {
-									sentence.length += 1;
-								}
+							if (sentence.operands[1].IsForeignSegment()) {
+								sentence.length += 1;
 							}
 
-							if (sentence.operands[1].table[6].present) {
+							if (sentence.operands[1].index != -1) {
 								sentence.length += 1;
 							}
 						}
 					}
-				} else if (sentence.mnemo.compare("ADD") == 0) {
-					if (sentence.operands.size() > 0) {
+				} else if (sentence.mnemo == keyword("ADD")) {
+					if (sentence.operands.size() > 1) {
 						if (sentence.operands[0].IsRegister() && sentence.operands[1].IsRegister()) {
 							sentence.length = 2;
 						}
 					}
-				} else if (sentence.mnemo.compare("MOV") == 0) {
+				} else if (sentence.mnemo == keyword("MOV")) {
 					if (sentence.operands.size() > 1) {
 						if (sentence.operands[0].IsMemory() && sentence.operands[1].IsImmediate()) {
 							sentence.length = 2;
 
-							if (sentence.operands[0].table[3].present || sentence.operands[0].table[4].present) {
+							const Operand &operand = sentence.operands[0];
+							auto symbol = (operand.ident != -1) ? symbolsTable.find(operand.Get(operand.ident).text) : symbolsTable.end();
+
+							if (operand.ident != -1) {
 								sentence.length += 2;
 							} else {
 								sentence.length += 1;
 							}
 
-							if ((sentence.operands[0].Get(1).present) && (sentence.operands[0].Get(1).first.compare("1") == 0)) {
+							if (operand.ptr == 1) {
 								sentence.length += 1;
 							} else {
 								sentence.length += 2;
 							}
 
-							if (sentence.operands[0].Get(2).present) {
-								if (sentence.operands[0].Get(2).first.compare("ds") != 0) {
+							if (operand.sreg != -1) {
+								if (operand.IsForeignSegment()) {
 									sentence.length += 1;
 								}
-							} else if (sentence.operands[0].table[3].present) {
-								if (segment.compare(symbolsTable.find(sentence.operands[0].Get(3).first)->second.segment) != 0) {
+							} else if (symbol != symbolsTable.end()) {
+								if (segment.compare(symbol->second.segment) != 0) {
 									sentence.length += 1;
 								}
 							}
 						}
 					}
-				} else if (sentence.mnemo.compare("JGE") == 0) {
+				} else if (sentence.mnemo == keyword("JGE")) {
 					if (sentence.operands.size() > 0) {
 						if (sentence.operands[0].IsIdentifier()) {
-							if (sentence.operands[0].Get(3).present) {
-								Symbol symbol = symbolsTable.find(sentence.operands[0].Get(3).first)->second;
+							auto found = symbolsTable.find(sentence.operands[0].Get(sentence.operands[0].ident).text);
+							if (found != symbolsTable.end()) {
+								Symbol symbol = found->second;
 								sentence.length = (offset - symbol.offset) > 0xFF ? 4 : 2;
 							} else {
 								sentence.length = 4;
 							}
 						}
 					}
-				} else if (sentence.mnemo.compare("CALL") == 0) {
+				} else if (sentence.mnemo == keyword("CALL")) {
 					if (sentence.operands.size() > 0) {
 						if (sentence.operands[0].IsRegister()) {
 							sentence.length = 2;
 						} else if (sentence.operands[0].IsMemory()) {
-							if (sentence.operands[0].Get(3).present) {
-								Symbol symbol = symbolsTable.find(sentence.operands[0].Get(3).first)->second;
+							const Operand &operand = sentence.operands[0];
+							auto found = (operand.ident != -1) ? symbolsTable.find(operand.Get(operand.ident).text) : symbolsTable.end();
+							if (found != symbolsTable.end()) {
+								Symbol symbol = found->second;
 								
 								if (symbol.type.compare("F PROC") == 0) {
 									sentence.length = 5;
 								} else if (symbol.type.compare("N PROC") == 0) {
-									if ((sentence.operands[0].Get(1).present) && (sentence.operands[0].Get(1).first.compare("-2") == 0)) {
+									if (operand.ptr == -2) {
 										sentence.length = 5;
 									} else {
 										sentence.length = 3;
 									}
 								} else {
-									if ((sentence.operands[0].Get(1).present) && (sentence.operands[0].Get(1).first.compare("-2") == 0)) {
+									if (operand.ptr == -2) {
 										sentence.length = 4;
 
-										if (sentence.operands[0].Get(2).present) {
+										if (operand.sreg != -1) {
 											sentence.length += 1;
 										}
 									} else {
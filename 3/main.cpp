@@ -5,6 +5,10 @@ using namespace std;
 #include <string>
 #include <vector>
 #include <map>
+#include <type_traits>
+
+#include "../common/dialects.h"
+#include "../common/operand.h"
 
 enum LexemType{
 	UNKNOWN,
@@ -28,6 +32,7 @@ struct Lexem {
 	LexemType type;
 	string text;
 	int index;
+	Term term;
 };
 
 map<LexemType, string> lexemInfo = {
@@ -48,199 +53,175 @@ map<LexemType, string> lexemInfo = {
 	{COMMAND, "command"}
 };
 
-map<string, LexemType> lexemType = {
-	{"assume", DIRECTIVE},
-	{"end", DIRECTIVE},
-	{"segment", DIRECTIVE},
-	{"ends", DIRECTIVE},
-	{"equ", DIRECTIVE},
-	{"if", DIRECTIVE}, 
-	{"else", DIRECTIVE},
-	{"endif", DIRECTIVE},
-
-	{"db", DATA_TYPE},
-	{"dw", DATA_TYPE},
-	{"dd", DATA_TYPE},
-
-	{"byte", PTR_TYPE},
-	{"dword", PTR_TYPE},
-	{"ptr", PTR_PTR},
-
-	{"eax", REG_32},
-	{"ebx", REG_32},
-	{"ecx", REG_32},
-	{"edx", REG_32},
-	{"esi", REG_32},
-	{"edi", REG_32},
-	{"esp", REG_32},
-	{"ebp", REG_32},
-
-	{"ah", REG_8},
-	{"bh", REG_8},
-	{"ch", REG_8},
-	{"dh", REG_8},
-	{"al", REG_8},
-	{"bl", REG_8},
-	{"cl", REG_8},
-	{"dl", REG_8},
-
-	{"cs", SEG_REG},
-	{"ds", SEG_REG},
-	{"ss", SEG_REG},
-	{"es", SEG_REG},
-	{"fs", SEG_REG},
-	{"gs", SEG_REG},
-
-	{"aaa", COMMAND},
-	{"inc", COMMAND},
-	{"div", COMMAND},
-	{"add", COMMAND},
-	{"cmp", COMMAND},
-	{"and", COMMAND},
-	{"imul", COMMAND},
-	{"or", COMMAND},
-	{"jbe", COMMAND}
-};
-
-inline bool isonechar(char c) {
-	return (c == '+') || (c == '-') || (c == '*') || (c == ':') || (c == ',') || (c == '[') || (c == ']');
-};
+LexemType lexemType(const Token &token) {
+	switch (token.type) {
+		case Token::OneChar: return ONE_CHAR;
+		case Token::Identifier: return USER_IDENT;
+		case Token::String: return STR_CONST;
+		case Token::Number: return token.radix == 2 ? BIN_CONST : (token.radix == 16 ? HEX_CONST : DEC_CONST);
+		case Token::Directive: return DIRECTIVE;
+		case Token::DataType: return DATA_TYPE;
+		case Token::PtrType: return PTR_TYPE;
+		case Token::Operator: return PTR_PTR;
+		case Token::SReg: return SEG_REG;
+		case Token::Reg32: return REG_32;
+		case Token::Reg8: return REG_8;
+		case Token::Command: return COMMAND;
+		default: return UNKNOWN;
+	}
+}
 
+// A number, or a lexem of the operand by its position. Copied as plain bytes.
 struct Value {
-	string text;
-	Lexem lexem;
-	long number;
-	int type;
-
-	Value() : type(-1) {}
-	Value(const long &value) : number(value), type(0) {}
-	Value(const Lexem &value) : lexem(value), type(1) {}
-	Value(const string &value) : text(value), type(2) {}
-
-	bool isNumber() { return type == 0; }
-	bool isToken() { return type == 1; }
-	bool isString() { return type == 2; }
-
-	string toString() {
-		switch (type) {
-			case 0: return to_string(number);
-			case 1: return lexem.text;
-			case 2: return text;
-		}
+	enum Type : unsigned char { None, Number, Position } type;
+	union {
+		long number;
+		int position;
+	};
+
+	Value() : type(None), number(-1) {}
+	Value(Type type, long value) : type(type), number(0) {
+		if (type == Position) position = value;
+		else number = value;
 	}
+
+	bool isNumber() const { return type == Number; }
+	bool isString() const { return type == Position; }
+};
+
+static_assert(is_trivially_copyable<Value>::value, "Value is copied as plain bytes");
+
+constexpr Rule stage3Operand[] = {
+	{0, Term::PtrType, 1, PendPtr, true},
+	{0, Term::Classes, 2, Skip, false},
+	{1, Term::Ptr, 2, SetPtr, true},
+	{1, Term::Classes, 2, Skip, false},
+	{2, Term::Reg8, 3, SetReg, true},
+	{2, Term::Reg32, 3, SetReg, true},
+	{2, Term::Number, 3, SetImm, true},
+	{2, Term::String, 3, SetText, true},
+	{2, Term::Classes, 3, Skip, false},
+	// [sreg:][name]
+	{3, Term::SReg, 4, PendSReg, true},
+	{3, Term::Classes, 5, Skip, false},
+	{4, Term::Colon, 5, SetSReg, true},
+	{4, Term::Classes, 5, Skip, false},
+	{5, Term::Identifier, 6, SetIdent, true},
+	{5, Term::Classes, 6, Skip, false},
+	// [[base + index]]
+	{6, Term::Open, 7, OpenMem, true},
+	{6, Term::Classes, OperandGrammar::Accept, Skip, false},
+	{7, Term::Reg32, 8, SetBase, true},
+	{7, Term::Classes, 10, Skip, false},
+	{8, Term::Plus, 9, Skip, true},
+	{8, Term::Classes, 10, Skip, false},
+	{9, Term::Reg32, 10, SetIndex, true},
+	{9, Term::Classes, 10, Skip, false},
+	{10, Term::Close, OperandGrammar::Accept, Skip, true},
+	{10, Term::Classes, OperandGrammar::Accept, Skip, false}
 };
 
+constexpr OperandGrammar operandGrammar(stage3Operand);
+
 struct Variable {
 	unsigned value;
 	string segment;
 	string type;
 };
 
+// Cursor over a span of one line's lexems. It never copies them, so the
+// line has to outlive it.
 struct Matcher {
-	vector<Lexem> lexems;
-	int index;
+	const Lexem *lexems;
+	int count, index;
 
-	Matcher() : index(0) {}
-	Matcher(const vector<Lexem> &lexems) : lexems(lexems), index(0) {}
+	Matcher(const vector<Lexem> &lexems) : Matcher(lexems.data(), lexems.size()) {}
+	Matcher(const Lexem *lexems, int count) : lexems(lexems), count(count), index(0) {}
 
 	void reset() { index = 0; }
-	void next() { if (index < lexems.size()) index++; }
-	Lexem &peek() {
-		static Lexem lexem;
-		return index < lexems.size() ? lexems[index] : lexem;
-	}
-	Lexem &get() {
-		Lexem &lexem = peek();
-		next();
-		return lexem;
-	}
-	void push(const Lexem &lexem) {
-		lexems.push_back(lexem);
-	}
+	void next() { if (index < count) index++; }
 
-	bool compare(const string &text) {
-		return peek().text.compare(text) == 0;
+	bool compare(const char *text) const {
+		return has() && (lexems[index].text.compare(text) == 0);
 	}
 
-	bool confirm(const string &text) {
+	bool confirm(const char *text) {
 		return compare(text) ? next(), true : false;
 	}
 
-	bool compare(const LexemType &type) {
-		return peek().type == type;
+	bool compare(const LexemType &type) const {
+		return has() && (lexems[index].type == type);
 	}
 
 	bool confirm(const LexemType &type) {
 		return compare(type) ? next(), true : false;
 	}
 
-	bool has() {
-		return index < lexems.size();
+	bool has() const {
+		return index < count;
 	}
 };
 
 struct Operand {
-	vector<Lexem> lexems;
-
-	struct Element {
-		bool present;
-		Value first, second;
-		Element() : present(false), first(-1), second(-1) {}
-		void set(bool present, const Value &first, const Value &second) {
-			this->present = present;
-			this->first = first;
-			this->second = second;
-		}
-	} table[10];
-
-	Operand(const vector<Lexem> &lexems) : lexems(lexems) { 
-		for (int i = 0; i < 10; i++) {
-			table[0].set(false, -1, -1);
-		}
+	// Parts an operand can have, one bit each.
+	enum Part : unsigned short {
+		Reg = 1, Ptr = 2, SReg = 4, Known = 8, Unknown = 16,
+		Base = 32, Index = 64, Scale = 128, Disp = 256, Imm = 512
+	};
+
+	// The operand is lexems [first, first + count) of its sentence.
+	int first, count;
+	unsigned short parts;
+	// Register size in bits and PTR size.
+	signed char size, ptr;
+	// Positions of these lexems in the sentence, -1 without.
+	short sreg, ident, base, index;
+	// The immediate number or string.
+	Value value;
+
+	Operand(int first, int count) : first(first), count(count), parts(0), size(0), ptr(0), sreg(-1), ident(-1), base(-1), index(-1) {}
+
+	bool has(unsigned parts) const {
+		return (this->parts & parts) != 0;
 	}
 
-	bool isREG() {
-		for (int i = 1; i < 10; i++) {
-			if (table[i].present) return false;
-		}
-		return table[0].present;
+	bool isREG() const {
+		return parts == Reg;
 	}
 
-	bool isIMM() {
-		for (int i = 2; i < 9; i++) {
-			if (table[i].present) return false;
-		}
-		return !table[0].present && table[9].present;
+	bool isIMM() const {
+		return (parts & ~Ptr) == Imm;
 	}
 
-	bool isMEM() {
-		if (table[0].present || table[9].present) return false;
-		for (int i = 3; i < 9; i++) {
-			if (table[i].present) return true;
-		}
-		return false;
+	bool isMEM() const {
+		return !has(Reg | Imm) && has(Known | Unknown | Base | Index | Scale | Disp);
 	}
 
-	bool isLabel() {
-		if (table[0].present || table[1].present) return false;
-		for (int i = 5; i < 10; i++) {
-			if (table[i].present) return false;
-		}
-		return table[3].present || table[4].present;
+	bool isLabel() const {
+		return !has(Reg | Ptr | Base | Index | Scale | Disp | Imm) && has(Known | Unknown);
 	}
 };
 
 struct Sentence {
 	vector<unsigned char> bytes;
 	vector<Operand> operands;
-	vector<Lexem> mnemocode;
 	vector<Lexem> lexems;
-	vector<Lexem> label;
+	// Positions of the label and the mnemocode, -1 without.
+	int label, mnemo;
 	unsigned length;
 	unsigned offset;
 	string input;
 
-	Sentence(const string &input, const vector<Lexem> &lexems) : input(input), lexems(lexems), length(0), offset(0) {}
+	Sentence(const string &input, vector<Lexem> &&lexems) : lexems(move(lexems)), label(-1), mnemo(-1), length(0), offset(0), input(input) {}
+
+	const Lexem &mnemocode() const {
+		return lexems[mnemo];
+	}
+
+	// Text of the lexem at position, empty for -1.
+	string text(int position) const {
+		return position == -1 ? "" : lexems[position].text;
+	}
 
 	void print(FILE *file) {
 		if (!input.empty()) {	
@@ -249,12 +230,12 @@ struct Sentence {
 			fprintf(file, " Мітка   Мнемокод    1-ий операнд      2-ий операнд\n");
 			fprintf(file, " індекс   індекс   індекс кількість  індекс кількість\n");
 
-			int lindex = label.empty() ? -1 : (label[0].index + 1);
-			int mindex = mnemocode.empty() ? -1 : (mnemocode[0].index + 1);
-			int o1index = operands.size() > 0 ? (operands[0].lexems[0].index + 1) : -1;
-			int o1count = operands.size() > 0 ? operands[0].lexems.size() : 0;
-			int o2index = operands.size() > 1 ? (operands[1].lexems[0].index + 1) : -1;
-			int o2count = operands.size() > 1 ? operands[1].lexems.size(): 0;
+			int lindex = label == -1 ? -1 : (label + 1);
+			int mindex = mnemo == -1 ? -1 : (mnemo + 1);
+			int o1index = operands.size() > 0 ? (operands[0].first + 1) : -1;
+			int o1count = operands.size() > 0 ? operands[0].count : 0;
+			int o2index = operands.size() > 1 ? (operands[1].first + 1) : -1;
+			int o2count = operands.size() > 1 ? operands[1].count : 0;
 			fprintf(file, " %6i  %8i  %6i %9i  %6i %9i\n\n", lindex, mindex, o1index, o1count, o2index, o2count);	
 			int index = 0;
 			for (Lexem &lexem : lexems) {
@@ -302,56 +283,28 @@ struct Look1 {
 
 vector<Lexem> Look1::divide(const string &input) {
 	vector<Lexem> lexems;
-	for (int i = 0, index = 0; i < input.size();) {
-		if (input[i] == ';') break;
-		else if (isspace(input[i])) i++;
-		else {
-			Lexem lexem;
-			lexem.index = index++;
-			if (isalpha(input[i])) {
-				while ((i < input.size()) && isalnum(input[i])) {
-					lexem.text += tolower(input[i++]);
-				}
-				auto type = lexemType.find(lexem.text);
-				if (type != lexemType.end()) {
-					lexem.type = type->second;
-				} else lexem.type = USER_IDENT;
-			} else if (isdigit(input[i])) {
-				while ((i < input.size()) && isxdigit(input[i])) {
-					lexem.text += tolower(input[i++]);
-				}
-				if (tolower(input.back()) == 'b') {
-					lexem.type = BIN_CONST;
-					lexem.text.pop_back();
-				} else if (tolower(input[i]) == 'h') {
-					lexem.type = HEX_CONST;
-					i++;
-				} else {
-					if (tolower(input[i]) == 'd') i++;
-					lexem.type = DEC_CONST;
-				}
-			} else if (input[i] == '\'') {
-				i++;
-				while ((i < input.size()) && (input[i] != '\'')) {
-					lexem.text += input[i++];
-				}
-				i++;
-				lexem.type = STR_CONST;
-			} else if (isonechar(input[i])) {
-				lexem.text = input[i++];
-				lexem.type = ONE_CHAR;
-			} else i++;
-
-			if (lexem.type == USER_IDENT) {
-				map<string, Variable>::iterator equ = variables.find(lexem.text);
-				if ((equ != variables.end()) && (equ->second.type.compare("NUMBER") == 0)) {
-					lexem.type = DEC_CONST;
-					lexem.text = to_string(equ->second.value);
-				}
-			}
+	Lexer lexer(stage3, input);
+	Token token;
+	for (int index = 0; lexer.next(token);) {
+		Lexem lexem;
+		lexem.index = index++;
+		lexem.type = lexemType(token);
+		lexem.text = string(token.text);
+		lexem.term = Term::of(token, token.keyword == -1 ? 0 : stage3.keywords[token.keyword].code);
+		if (token.type != Token::String) {
+			for (char &c : lexem.text) c = stage3.fold(c);
+		}
 
-			lexems.push_back(lexem);
+		if (lexem.type == USER_IDENT) {
+			map<string, Variable>::iterator equ = variables.find(lexem.text);
+			if ((equ != variables.end()) && (equ->second.type.compare("NUMBER") == 0)) {
+				lexem.type = DEC_CONST;
+				lexem.text = to_string(equ->second.value);
+				lexem.term = Term(Term::Number, 0, equ->second.value);
+			}
 		}
+
+		lexems.push_back(lexem);
 	}
 	return lexems;
 }
@@ -363,271 +316,252 @@ void Look1::printOffset() {
 }
 
 void Look1::parse(const string &input) {
-	vector<Lexem> lexems = divide(input);
-	Sentence sentence(input, lexems);
+	Sentence sentence(input, divide(input));
+	const vector<Lexem> &lexems = sentence.lexems;
 	Matcher matcher(lexems);
 	printed = false;
 
+	bool colon = false;
 	if (matcher.compare(USER_IDENT)) {
-		sentence.label.push_back(matcher.get());
-		if (matcher.compare(":")) {
+		sentence.label = matcher.index;
+		matcher.next();
+		if (matcher.confirm(":")) {
+			colon = true;
 			Variable variable;
 			variable.type = "L NEAR";
 			variable.value = offset;
 			variable.segment = segment;
-			variables[sentence.label[0].text] = variable;
+			variables[lexems[sentence.label].text] = variable;
 			printOffset();
-
-			sentence.label.push_back(matcher.get());
 		}
 	}
 
 	if (matcher.compare(DIRECTIVE) || matcher.compare(COMMAND) || matcher.compare(DATA_TYPE)) {
-		sentence.mnemocode.push_back(matcher.get());
+		sentence.mnemo = matcher.index;
+		matcher.next();
 
 		while (matcher.has()) {
-			vector<Lexem> lexems;
-			while (matcher.has() && !matcher.confirm(",")) {
-				lexems.push_back(matcher.get());
+			int first = matcher.index;
+			while (matcher.has() && !matcher.compare(",")) {
+				matcher.next();
 			}
-			Operand operand(lexems);
+			Operand operand(first, matcher.index - first);
+			matcher.confirm(",");
 
-			Matcher matcher(lexems);
+			const Descriptor form = operandGrammar.parse(lexems.data() + first, operand.count);
 
-			if (matcher.compare(PTR_TYPE)) {
-				string ptr = matcher.get().text;
+			if (form.has(Descriptor::PtrPart)) {
+				operand.parts |= Operand::Ptr;
+				operand.ptr = form.ptr;
+			}
 
-				if (matcher.confirm(PTR_PTR)) {
-					if (ptr.compare("byte") == 0) {
-						operand.table[1].set(true, 1, -1);
-					} else if (ptr.compare("word") == 0) {
-						operand.table[1].set(true, 2, -1);
-					} else if (ptr.compare("dword") == 0) {
-						operand.table[1].set(true, 4, -1);
-					}
-				}
+			if (form.has(Descriptor::RegPart)) {
+				operand.parts |= Operand::Reg;
+				operand.size = form.reg.type == Term::Reg8 ? 8 : 32;
+			} else if (form.has(Descriptor::ImmPart)) {
+				operand.parts |= Operand::Imm;
+				operand.value = Value(Value::Number, form.imm);
+			} else if (form.has(Descriptor::TextPart)) {
+				operand.parts |= Operand::Imm;
+				operand.value = Value(Value::Position, first + form.text);
 			}
 
-			if (matcher.compare(REG_8)) {
-				operand.table[0].set(true, 8, matcher.get());
-			} else if (matcher.compare(REG_32)) {
-				operand.table[0].set(true, 32, matcher.get());
-			} else if (matcher.compare(BIN_CONST)) {
-				operand.table[9].set(true, stol(matcher.get().text, 0, 2), -1);
-			} else if (matcher.compare(DEC_CONST)) {
-				operand.table[9].set(true, stol(matcher.get().text, 0, 10), -1);
-			} else if (matcher.compare(HEX_CONST)) {
-				operand.table[9].set(true, stol(matcher.get().text, 0, 16), -1);
-			} else if (matcher.compare(STR_CONST)) {
-				operand.table[9].set(true, matcher.get().text, -1);
+			if (form.has(Descriptor::SRegPart)) {
+				operand.parts |= Operand::SReg;
+				operand.sreg = first + form.sreg.at;
 			}
 
-			if (matcher.compare(SEG_REG)) {
-				Lexem &sreg = matcher.get();
-				if (matcher.confirm(":")) {
-					operand.table[2].set(true, sreg, -1);
-				}
+			if (form.has(Descriptor::IdentPart)) {
+				operand.parts |= (variables.find(lexems[first + form.ident].text) != variables.end()) ? Operand::Known : Operand::Unknown;
+				operand.ident = first + form.ident;
 			}
 
-			if (matcher.compare(USER_IDENT)) {
-				Lexem &ident = matcher.get();
-				if (variables.find(ident.text) != variables.end()) {
-					operand.table[3].set(true, ident, -1);
-				} else {
-					operand.table[4].set(true, ident, -1);
-				}
+			if (form.has(Descriptor::BasePart)) {
+				operand.parts |= Operand::Base;
+				operand.base = first + form.base.at;
 			}
 
-			if (matcher.confirm("[")) {
-				if (matcher.compare(REG_32)) {
-					operand.table[5].set(true, matcher.get(), 32);
-					if (matcher.confirm("+")) {
-						if (matcher.compare(REG_32)) {	
-							Lexem &reg = matcher.get();
-							operand.table[6].set(true, reg, 32);
-							operand.table[7].set(true, reg, 1);
-						}
-					}	
-				}
-				matcher.confirm("]");
+			if (form.has(Descriptor::IndexPart)) {
+				operand.parts |= Operand::Index | Operand::Scale;
+				operand.index = first + form.index.at;
 			}
 
 			sentence.operands.push_back(operand);
 		}
 
-		if (sentence.mnemocode[0].text.compare("if") == 0) {
+		if (sentence.mnemocode().text.compare("if") == 0) {
 			IF context;
-			context.value = sentence.operands[0].table[9].first.number;
+			context.value = sentence.operands[0].value.number;
 			ifTable.push_back(context);
 			if (!context.value) return;
-		} else if (sentence.mnemocode[0].text.compare("else") == 0) {
+		} else if (sentence.mnemocode().text.compare("else") == 0) {
 			IF &context = ifTable.back();
 			context.value = !context.value;
 			if (!context.value) return;
-		} else if (sentence.mnemocode[0].text.compare("endif") == 0) { 
+		} else if (sentence.mnemocode().text.compare("endif") == 0) { 
 			ifTable.pop_back();
 		} else if (!ifTable.empty() && !ifTable.back().value) {
 			return;
-		} else if (sentence.mnemocode[0].text.compare("equ") == 0) {
+		} else if (sentence.mnemocode().text.compare("equ") == 0) {
 			fprintf(out, " = ");
 			Variable variable;
 			variable.type = "NUMBER";
 			variable.segment = "";
-			if (sentence.operands[0].table[9].first.isNumber()) {
-				variable.value = sentence.operands[0].table[9].first.number;	
+			if (sentence.operands[0].value.isNumber()) {
+				variable.value = sentence.operands[0].value.number;	
 				fprintf(out, "%2X", variable.value);
 			} else variable.value = 0;
-			variables[sentence.label[0].text] = variable;
-		} else if (sentence.mnemocode[0].text.compare("assume") == 0) {
+			variables[sentence.text(sentence.label)] = variable;
+		} else if (sentence.mnemocode().text.compare("assume") == 0) {
 			for (Operand &operand : sentence.operands) {
-				assume_table[operand.table[2].first.lexem.text] = operand.table[4].first.lexem.text;
+				assume_table[sentence.text(operand.sreg)] = operand.has(Operand::Unknown) ? sentence.text(operand.ident) : "";
 			}
-		} else if (sentence.mnemocode[0].text.compare("segment") == 0) {
+		} else if (sentence.mnemocode().text.compare("segment") == 0) {
 			offset = 0;
 			printOffset();
-			if (sentence.label.size() == 1)
-				segment = sentence.label[0].text;
-		} else if (sentence.mnemocode[0].text.compare("ends") == 0) {
+			if ((sentence.label != -1) && !colon)
+				segment = sentence.text(sentence.label);
+		} else if (sentence.mnemocode().text.compare("ends") == 0) {
 			printOffset();
 			segment_table[segment] = offset;
 			offset = 0;
 			segment.clear();
-		} else if (sentence.mnemocode[0].text.compare("end") == 0) {
-		} else if (sentence.mnemocode[0].type == DATA_TYPE) {
+		} else if (sentence.mnemocode().text.compare("end") == 0) {
+		} else if (sentence.mnemocode().type == DATA_TYPE) {
 			printOffset();
 			Variable variable;
 			variable.value = offset;
 			variable.segment = segment;
 
-			if (sentence.mnemocode[0].text.compare("db") == 0) {
+			if (sentence.mnemocode().text.compare("db") == 0) {
 				variable.type = "L BYTE";
-				if (sentence.operands[0].table[9].first.isString()) {
-					sentence.length = sentence.operands[0].table[9].first.text.size();
+				if (sentence.operands[0].value.isString()) {
+					sentence.length = sentence.text(sentence.operands[0].value.position).size();
 				} else sentence.length = 1; 
-			} else if (sentence.mnemocode[0].text.compare("dw") == 0) {
+			} else if (sentence.mnemocode().text.compare("dw") == 0) {
 				variable.type = "L WORD";
 				sentence.length = 2;
-			} else if (sentence.mnemocode[0].text.compare("dd") == 0) {
+			} else if (sentence.mnemocode().text.compare("dd") == 0) {
 				variable.type = "L DWORD";
 				sentence.length = 4;
 			} 
 
-			if (sentence.label.size() == 1)
-				variables[sentence.label[0].text] = variable;
+			if ((sentence.label != -1) && !colon)
+				variables[sentence.text(sentence.label)] = variable;
 		} else {
 			printOffset();
-			if (sentence.mnemocode[0].text.compare("aaa") == 0) {
+			if (sentence.mnemocode().text.compare("aaa") == 0) {
 				sentence.length = 1;
-			} else if (sentence.mnemocode[0].text.compare("inc") == 0) {
+			} else if (sentence.mnemocode().text.compare("inc") == 0) {
 				if (sentence.operands[0].isREG()) {
-					if (sentence.operands[0].table[0].first.number == 8) {
+					if (sentence.operands[0].size == 8) {
 						sentence.length = 2;
-					} else if (sentence.operands[0].table[0].first.number == 32) {
+					} else if (sentence.operands[0].size == 32) {
 						sentence.length = 1;
 					}
 				}
-			} else if (sentence.mnemocode[0].text.compare("div") == 0) {
+			} else if (sentence.mnemocode().text.compare("div") == 0) {
 				if (sentence.operands[0].isMEM()) {
 					sentence.length = 2;
 
-					if (sentence.operands[0].table[3].present || sentence.operands[0].table[4].present) {
+					if (sentence.operands[0].has(Operand::Known | Operand::Unknown)) {
 						sentence.length += 4;
 					}
 
-					if (sentence.operands[0].table[3].present && (variables.find(sentence.operands[0].table[3].first.toString())->second.segment.compare(default_segment) != 0)) {
+					if (sentence.operands[0].has(Operand::Known) && (variables.find(sentence.text(sentence.operands[0].ident))->second.segment.compare(default_segment) != 0)) {
 						sentence.length += 1;
-					} else if (sentence.operands[0].table[2].present) {
-						if (default_segment.compare(sentence.operands[0].table[2].first.lexem.text) != 0) {
+					} else if (sentence.operands[0].has(Operand::SReg)) {
+						if (default_segment.compare(sentence.text(sentence.operands[0].sreg)) != 0) {
 							sentence.length += 1;
 						}
 					} 
 
-					if (sentence.operands[0].table[6].present) {
+					if (sentence.operands[0].has(Operand::Index)) {
 						sentence.length += 1;
 					}
 				}
-			} else if (sentence.mnemocode[0].text.compare("add") == 0) {
+			} else if (sentence.mnemocode().text.compare("add") == 0) {
 				if (sentence.operands[0].isREG() && sentence.operands[1].isREG()) {
 					sentence.length = 2;
 				}
-			} else if (sentence.mnemocode[0].text.compare("cmp") == 0) {
+			} else if (sentence.mnemocode().text.compare("cmp") == 0) {
 				if (sentence.operands[0].isREG() && sentence.operands[1].isMEM()) {
 					sentence.length = 2;
 
-					if (sentence.operands[1].table[3].present || sentence.operands[1].table[4].present) {
+					if (sentence.operands[1].has(Operand::Known | Operand::Unknown)) {
 						sentence.length += 4;
 					}
 
-					if (sentence.operands[1].table[2].present) {
-						if (default_segment.compare(sentence.operands[1].table[2].first.lexem.text) != 0) {
+					if (sentence.operands[1].has(Operand::SReg)) {
+						if (default_segment.compare(sentence.text(sentence.operands[1].sreg)) != 0) {
 							sentence.length += 1;
 						}
 					}
 
-					if (sentence.operands[1].table[6].present) {
+					if (sentence.operands[1].has(Operand::Index)) {
 						sentence.length += 1;
 					}
 				}
-			} else if (sentence.mnemocode[0].text.compare("and") == 0) {
+			} else if (sentence.mnemocode().text.compare("and") == 0) {
 				if (sentence.operands[0].isMEM() && sentence.operands[1].isREG()) {
 					sentence.length = 2;
 
-					if (sentence.operands[0].table[3].present || sentence.operands[0].table[4].present) {
+					if (sentence.operands[0].has(Operand::Known | Operand::Unknown)) {
 						sentence.length += 4;
 					}
 
-					if (sentence.operands[0].table[2].present) {
-						if (default_segment.compare(sentence.operands[0].table[2].first.lexem.text) != 0) {
+					if (sentence.operands[0].has(Operand::SReg)) {
+						if (default_segment.compare(sentence.text(sentence.operands[0].sreg)) != 0) {
 							//sentence.length += 1;
 						}
 					}
 
-					if (sentence.operands[0].table[6].present) {
+					if (sentence.operands[0].has(Operand::Index)) {
 						sentence.length += 1;
 					}
 				}
-			} else if (sentence.mnemocode[0].text.compare("imul") == 0) {
+			} else if (sentence.mnemocode().text.compare("imul") == 0) {
 				if (sentence.operands[0].isREG() && sentence.operands[1].isIMM()) {
-					if (sentence.operands[0].table[0].first.number == 8) {
+					if (sentence.operands[0].size == 8) {
 					 	sentence.length = 3;
-					} else if (sentence.operands[0].table[0].first.number == 32) {
+					} else if (sentence.operands[0].size == 32) {
 					 	sentence.length = 6;
 					}
 				}
-			} else if (sentence.mnemocode[0].text.compare("or") == 0) {
+			} else if (sentence.mnemocode().text.compare("or") == 0) {
 				if (sentence.operands[0].isMEM() && sentence.operands[1].isIMM()) {
 					sentence.length = 2;
 
-					if (sentence.operands[0].table[3].present || sentence.operands[0].table[4].present) {
+					if (sentence.operands[0].has(Operand::Known | Operand::Unknown)) {
 						sentence.length += 4;
 					}
 
-					long number = sentence.operands[1].table[9].first.number;
+					long number = sentence.operands[1].value.number;
 					int size = number == 0 ? 0 : (((number >= -128) && (number <= 127)) ? 1 : 4);
-					if (sentence.operands[0].table[1].present) {
-						if (sentence.operands[0].table[1].first.number == 1) {
+					if (sentence.operands[0].has(Operand::Ptr)) {
+						if (sentence.operands[0].ptr == 1) {
 							sentence.length += 1;
-						} else if (sentence.operands[0].table[1].first.number == 4) {
+						} else if (sentence.operands[0].ptr == 4) {
 							sentence.length += size;
 						}
 					} else {
 						sentence.length += size;
 					}
 
-					if (sentence.operands[0].table[2].present) {
-						if (default_segment.compare(sentence.operands[0].table[2].first.lexem.text) != 0) {
+					if (sentence.operands[0].has(Operand::SReg)) {
+						if (default_segment.compare(sentence.text(sentence.operands[0].sreg)) != 0) {
 							sentence.length += 1;
 						}
 					}
 
-					if (sentence.operands[0].table[6].present) {
+					if (sentence.operands[0].has(Operand::Index)) {
 						sentence.length += 1;
 					}		
 				}
-			} else if (sentence.mnemocode[0].text.compare("jbe") == 0) {
+			} else if (sentence.mnemocode().text.compare("jbe") == 0) {
 				if (sentence.operands[0].isLabel()) {
-					if (sentence.operands[0].table[3].first.isToken()) {
-						Variable &variable = variables.find(sentence.operands[0].table[3].first.lexem.text)->second;
+					if (sentence.operands[0].has(Operand::Known)) {
+						Variable &variable = variables.find(sentence.text(sentence.operands[0].ident))->second;
 						long delta = offset - variable.value;
 						if (delta > 0xFF) sentence.length = 6;
 						else sentence.length = 2;
@@ -641,8 +575,8 @@ void Look1::parse(const string &input) {
 
 	sentence.offset = offset;
 	offset += sentence.length;
-	sentences.push_back(sentence);	
 	fprintf(out, "\t\t%s\n", sentence.input.c_str());
+	sentences.push_back(move(sentence));
 }
 
 void Look1::run(const string &filepath) {
@@ -2,156 +2,410 @@ using namespace std;
 
 #include <iostream>
 #include <fstream>
-#include <cstdarg>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <deque>
+#include <functional>
 #include <map>
-
-bool isquote(char c) {
-	return (c == '"') || (c == '\'');
-}
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <filesystem>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../common/dialects.h"
+#include "../common/operand.h"
+#include "../common/isa.h"
 
 bool issymbol(char c) {
 	return (c == '*') || (c == ':') || (c == ',') || (c == '[') || (c == ']');
 }
 
-std::string format(const char *fmt, ...) {
-	std::string result;
-
-	va_list ap;
-	va_start(ap, fmt);
-
-	char *tmp = 0;
-	vasprintf(&tmp, fmt, ap);
-	va_end(ap);
-
-	result = tmp;
-	free(tmp);
-
-	return result;
-}
-
-struct Lexem {
-	enum Type {
-		Unknown,
-		OneChar,
-		Number,
-		String,
-		Identifier,
-		Directive,
-		DataType,
-		PtrType,
-		Operator,
-		Reg8,
-		Reg32,
-		SReg,
-		Command
-	} type;
-	string text;
-	int index, begin, end;
-	Lexem() : Lexem(Type::Unknown, "", 0, 0, 0) {}
-	Lexem(const Type &type, const string &text, const int &index, const int &begin, const int &end) {
-		this->text = text;
-		this->type = type;
-		this->index = index;
-		this->begin = begin;
-		this->end = end;
-	} 
+// Numbers are rendered into buffers of the caller; each function returns the
+// end of what it wrote. Hex goes a byte at a time through a table of digit
+// pairs.
+struct HexDigits {
+	char pairs[256][2];
+
+	constexpr HexDigits() : pairs() {
+		for (int i = 0; i < 256; i++) {
+			pairs[i][0] = "0123456789ABCDEF"[i >> 4];
+			pairs[i][1] = "0123456789ABCDEF"[i & 15];
+		}
+	}
+};
+
+constexpr HexDigits hexDigits;
+
+// Upper case, at least Digits of them: room for 8 is enough.
+template<int Digits>
+char *toHex(char *to, unsigned value) {
+	static_assert((Digits > 0) && (Digits <= 8), "an unsigned has 1 to 8 hex digits");
+	int count = 1;
+	for (unsigned rest = value >> 4; rest; rest >>= 4) count++;
+	if (count < Digits) count = Digits;
+	char *at = to + count;
+	for (; at - to > 1; value >>= 8) {
+		at -= 2;
+		at[0] = hexDigits.pairs[value & 255][0];
+		at[1] = hexDigits.pairs[value & 255][1];
+	}
+	if (at != to) *to = hexDigits.pairs[value & 15][1];
+	return to + count;
+}
+
+// Room for 20 is enough.
+char *toDec(char *to, long value) {
+	char text[20];
+	int count = 0;
+	unsigned long magnitude = value < 0 ? 0 - (unsigned long)value : value;
+	do {
+		text[sizeof(text) - ++count] = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while (magnitude);
+	if (value < 0) *to++ = '-';
+	memcpy(to, text + sizeof(text) - count, count);
+	return to + count;
+}
+
+// The lexems of a run as parallel arrays, one entry per lexem. A sentence is a
+// range of them, and scans that only ask what kind a lexem is walk a byte
+// array.
+struct Tokens {
+	vector<Token::Type> types;
+	vector<int> keywords;
+	// What the operand parser sees: class, register code or size, symbol id
+	// and value.
+	vector<Term> terms;
+	// The text and its columns in the line it was read from.
+	vector<string_view> texts;
+	vector<int> begins, ends;
+
+	int size() const {
+		return types.size();
+	}
+
+	bool is(int i, char c) const {
+		return (types[i] == Token::OneChar) && (texts[i][0] == c);
+	}
+
+	void push(const Token &token, const Term &term) {
+		types.push_back(token.type);
+		keywords.push_back(token.keyword);
+		terms.push_back(term);
+		texts.push_back(token.text);
+		begins.push_back(token.begin);
+		ends.push_back(token.end);
+	}
+
+	// from may be this stream itself, so the room is made first. It grows
+	// by doubling, as push_back would.
+	void append(const Tokens &from, int first, int count) {
+		if (size() + count > (int)types.capacity()) reserve(max<int>(size() + count, 2 * types.capacity()));
+		for (int i = first; i < first + count; i++) {
+			types.push_back(from.types[i]);
+			keywords.push_back(from.keywords[i]);
+			terms.push_back(from.terms[i]);
+			texts.push_back(from.texts[i]);
+			begins.push_back(from.begins[i]);
+			ends.push_back(from.ends[i]);
+		}
+	}
+
+	void reserve(int count) {
+		types.reserve(count);
+		keywords.reserve(count);
+		terms.reserve(count);
+		texts.reserve(count);
+		begins.reserve(count);
+		ends.reserve(count);
+	}
+
+	void clear() {
+		types.clear();
+		keywords.clear();
+		terms.clear();
+		texts.clear();
+		begins.clear();
+		ends.clear();
+	}
+
+	// What the arrays hold room for.
+	size_t bytes() const {
+		return types.capacity() * (sizeof(Token::Type) + sizeof(int) + sizeof(Term) + sizeof(string_view) + 2 * sizeof(int));
+	}
 };
 
-string getinfo(Lexem::Type type) {
+string getinfo(Token::Type type) {
 	switch (type) {
-		case Lexem::OneChar: return "one char";
-		case Lexem::Number: return "heximal";
-		case Lexem::String: return "string";
-		case Lexem::Identifier: return "identifier";
-		case Lexem::Directive: return "directive";
-		case Lexem::DataType: return "data type";
-		case Lexem::PtrType: return "ptr type";
-		case Lexem::Operator: return "ptr operator";
-		case Lexem::Reg8: return "register 8-bit";
-		case Lexem::Reg32: return "register 32-bit";
-		case Lexem::SReg: return "segment register";
-		case Lexem::Command: return "command";
+		case Token::OneChar: return "one char";
+		case Token::Number: return "heximal";
+		case Token::String: return "string";
+		case Token::Identifier: return "identifier";
+		case Token::Directive: return "directive";
+		case Token::DataType: return "data type";
+		case Token::PtrType: return "ptr type";
+		case Token::Operator: return "ptr operator";
+		case Token::Reg8: return "register 8-bit";
+		case Token::Reg16: return "register 16-bit";
+		case Token::Reg32: return "register 32-bit";
+		case Token::SReg: return "segment register";
+		case Token::Command: return "command";
+		case Token::Unknown: break;
 	}
 	return "Unknown";
 }
 
-map<string, Lexem::Type> keywords = {
-	{"ASSUME", Lexem::Directive},
-	{"END", Lexem::Directive},
-	{"SEGMENT", Lexem::Directive},
-	{"ENDS", Lexem::Directive},
-	{"EQU", Lexem::Directive},
-	{"IF", Lexem::Directive},
-	{"ENDIF", Lexem::Directive},
-
-	{"DB", Lexem::DataType},
-	{"DW", Lexem::DataType},
-	{"DD", Lexem::DataType},
-
-	{"BYTE", Lexem::PtrType},
-	//{"WORD", Lexem::PtrType},
-	{"DWORD", Lexem::PtrType},
-	{"PTR", Lexem::Operator},
-
-	{"AH", Lexem::Reg8},
-	{"BH", Lexem::Reg8},
-	{"CH", Lexem::Reg8},
-	{"DH", Lexem::Reg8},
-	{"AL", Lexem::Reg8},
-	{"BL", Lexem::Reg8},
-	{"CL", Lexem::Reg8},
-	{"DL", Lexem::Reg8},
-
-	{"EAX", Lexem::Reg32},
-	{"EBX", Lexem::Reg32},
-	{"ECX", Lexem::Reg32},
-	{"EDX", Lexem::Reg32},
-	{"ESI", Lexem::Reg32},
-	{"EDI", Lexem::Reg32},
-	{"ESP", Lexem::Reg32},
-	{"EBP", Lexem::Reg32},
-
-	{"CS", Lexem::SReg},
-	{"DS", Lexem::SReg},
-	{"SS", Lexem::SReg},
-	{"ES", Lexem::SReg},
-	{"FS", Lexem::SReg},
-	{"GS", Lexem::SReg},
-
-	{"STOSD", Lexem::Command},
-	{"DEC", Lexem::Command},
-	{"INC", Lexem::Command},
-	{"XOR", Lexem::Command},
-	{"OR", Lexem::Command},
-	{"AND", Lexem::Command},
-	{"MOV", Lexem::Command},
-	{"ADC", Lexem::Command},
-	{"JZ", Lexem::Command}
+// Index of a keyword, for comparing against Tokens::keywords.
+constexpr int keyword(const char *text) {
+	return stage7.keywords.find(text);
+}
+
+// Register number or size a keyword stands for.
+constexpr int code(const char *text) {
+	return stage7.keywords[keyword(text)].code;
+}
+
+// A label or variable is an offset into a segment, a numeric EQU a number.
+// The text of a text EQU is its Equ's. Nothing here is text until the tables
+// are printed.
+struct Symbol {
+	enum Kind : unsigned char { Label, Variable, Number, Text } kind;
+	// Bytes of a variable.
+	unsigned char size;
+	bool defined;
+	// Name id of the segment, -1 for none.
+	int segment;
+	unsigned value;
+
+	Symbol() : kind(Label), size(0), defined(false), segment(-1), value(0) {}
+	Symbol(Kind kind, int segment, unsigned value, int size = 0) : kind(kind), size(size), defined(false), segment(segment), value(value) {}
+
+	bool isOffset() const {
+		return (kind == Label) || (kind == Variable);
+	}
 };
 
-inline bool isonechar(char c) {
-	return (c == '+') || (c == '-') || (c == '*') || (c == ':') || (c == ',') || (c == '[') || (c == ']');
+// An EQU keeps its body as written and is expanded on first use. Nested
+// references are resolved recursively and the result is kept, so every later
+// use splices the same span of tokens and the same text.
+struct Equ {
+	enum State { Unresolved, Resolving, Resolved, Recursive } state;
+	Tokens body;
+	string_view source, text;
+	int first, count;
+
+	Equ() : state(Unresolved), first(0), count(0) {}
 };
 
-map<int, string> symbolType = {
-	{-3, "ЧИСЛО"},
-	{-1, "МІТКА "},
-	{ 1, "БАЙТ  "},
-	{ 2, "1 СЛОВО"},
-	{ 4, "2 СЛОВА"}
+// Part [begin, end) of a source line that the listing shows as text instead.
+struct Splice {
+	int begin, end;
+	string_view text;
 };
 
-struct Symbol {
-	string segment, value, type, text;
+// A run of objects owned by someone else, usually the arena.
+template<class T>
+struct Span {
+	T *data;
+	int count;
+
+	Span() : data(nullptr), count(0) {}
+	Span(T *data, int count) : data(data), count(count) {}
+
+	int size() const { return count; }
+	bool empty() const { return count == 0; }
+	T &operator[](int i) const { return data[i]; }
+	T *begin() const { return data; }
+	T *end() const { return data + count; }
+};
+
+// Bump allocator that owns the sentences of one run together with their
+// operands, splices and texts. Nothing in it is destroyed one by one: reset()
+// takes everything back at once and keeps the blocks for the next use. What
+// each phase asked for is counted, across resets.
+struct Arena {
+	enum Phase { Lex, Parse, Lookup, Phases };
+	enum { BlockSize = 64 * 1024 };
+
+	struct Block {
+		char *data;
+		size_t size;
+	};
+
+	vector<Block> blocks;
+	size_t current, used;
+	size_t allocated[Phases];
+	Phase phase;
+
+	Arena() : current(0), used(0), allocated{}, phase(Lex) {}
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+	~Arena() {
+		for (auto &block : blocks) free(block.data);
+	}
+
+	void *allocate(size_t size, size_t align) {
+		allocated[phase] += size;
+		for (; current < blocks.size(); current++, used = 0) {
+			size_t at = (used + align - 1) & ~(align - 1);
+			if (at + size <= blocks[current].size) {
+				used = at + size;
+				return blocks[current].data + at;
+			}
+		}
+		Block block = {(char *)malloc(max<size_t>(size, BlockSize)), max<size_t>(size, BlockSize)};
+		if (!block.data) throw bad_alloc();
+		blocks.push_back(block);
+		current = blocks.size() - 1;
+		used = size;
+		return block.data;
+	}
+
+	// Uninitialized room for count objects.
+	template<class T>
+	Span<T> allocate(int count) {
+		static_assert(is_trivially_destructible<T>::value, "arena objects are never destroyed");
+		return Span<T>((T *)allocate(count * sizeof(T), alignof(T)), count);
+	}
 
-	Symbol() {}
-	Symbol(const string &segment, const string &value, const string &type) {
-		this->segment = segment;
-		this->value = value;
-		this->type = type;
-		this->text = "";
+	template<class T>
+	Span<T> copy(const vector<T> &from) {
+		Span<T> to = allocate<T>(from.size());
+		uninitialized_copy(from.begin(), from.end(), to.data);
+		return to;
+	}
+
+	string_view copy(const string_view &text) {
+		Span<char> to = allocate<char>(text.size());
+		memcpy(to.data, text.data(), text.size());
+		return string_view(to.data, to.count);
+	}
+
+	void reset() {
+		current = 0;
+		used = 0;
+	}
+
+	size_t reserved() const {
+		size_t size = 0;
+		for (auto &block : blocks) size += block.size;
+		return size;
+	}
+};
+
+// The listing and the analysis are rendered into a large buffer, which goes
+// out with a single write whenever it fills up and when the writer is done.
+// A writer without a file keeps everything, growing the buffer instead.
+// Fields follow printf: a negative width aligns to the left.
+struct Writer {
+	enum { Capacity = 1 << 20 };
+
+	int fd;
+	bool owned, growing;
+	char *buffer;
+	size_t size, capacity;
+
+	Writer(int fd) : fd(fd), owned(false), growing(false), buffer((char *)malloc(Capacity)), size(0), capacity(Capacity) {
+		if (!buffer) throw bad_alloc();
+	}
+	Writer() : Writer(-1) {
+		growing = true;
+	}
+	// Creates the file, fd is -1 when it cannot.
+	Writer(const string &path) : Writer(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)) {
+		owned = true;
+	}
+	Writer(const Writer &) = delete;
+	Writer &operator=(const Writer &) = delete;
+	~Writer() {
+		flush();
+		free(buffer);
+		if (owned && (fd != -1)) close(fd);
+	}
+
+	void write(const char *data, size_t count) {
+		for (size_t written = 0; written < count;) {
+			ssize_t done = ::write(fd, data + written, count - written);
+			if (done <= 0) break;
+			written += done;
+		}
+	}
+
+	void flush() {
+		if (growing) return;
+		write(buffer, size);
+		size = 0;
+	}
+
+	// Room for count more characters.
+	char *reserve(size_t count) {
+		if (size + count <= capacity) return buffer + size;
+		flush();
+		if (size + count > capacity) {
+			size_t grown = max(size + count, growing ? 2 * capacity : 0);
+			char *to = (char *)realloc(buffer, grown);
+			if (!to) throw bad_alloc();
+			buffer = to;
+			capacity = grown;
+		}
+		return buffer + size;
+	}
+
+	// What another writer holds; a lot of it goes to the file directly.
+	void append(const Writer &from) {
+		if (growing || (size + from.size <= capacity)) {
+			put(string_view(from.buffer, from.size));
+		} else {
+			flush();
+			write(from.buffer, from.size);
+		}
+	}
+
+	void put(char c) {
+		*reserve(1) = c;
+		size++;
+	}
+
+	void put(const string_view &text) {
+		memcpy(reserve(text.size()), text.data(), text.size());
+		size += text.size();
+	}
+
+	void fill(char c, int count) {
+		if (count <= 0) return;
+		memset(reserve(count), c, count);
+		size += count;
+	}
+
+	void put(const string_view &text, int width) {
+		if (width > 0) fill(' ', width - (int)text.size());
+		put(text);
+		if (width < 0) fill(' ', -width - (int)text.size());
+	}
+
+	// Returns how many digits it wrote.
+	template<int Digits>
+	int hex(unsigned value) {
+		char *to = reserve(8);
+		int count = toHex<Digits>(to, value) - to;
+		size += count;
+		return count;
+	}
+
+	void dec(long value, int width = 0) {
+		char text[20];
+		put(string_view(text, toDec(text, value) - text), width);
 	}
 };
 
@@ -163,122 +417,137 @@ struct Info {
 	}
 };
 
-struct Operand {
-	enum class Type {
-		Undef, Reg, Mem, Imm, Text, Name
-	} type;
-
-	vector<Lexem> lexems;
-	Info info;
+constexpr Rule stage7Operand[] = {
+	{0, Term::PtrType, 1, PendPtr, true},
+	{0, Term::Reg8, 9, SetReg, true},
+	{0, Term::Reg32, 9, SetReg, true},
+	{0, Term::Number, 9, SetImm, true},
+	{0, Term::String, 9, SetText, true},
+	{0, Term::Classes, 2, Skip, false},
+	{1, Term::Ptr, 2, SetPtr, true},
+	// [sreg:]name[index * scale]
+	{2, Term::SReg, 3, PendSReg, true},
+	{2, Term::Identifier, 4, SetIdent, true},
+	{3, Term::Colon, 5, SetSReg, true},
+	{3, Term::End, OperandGrammar::Accept, Skip, false},
+	{5, Term::Identifier, 4, SetIdent, true},
+	{4, Term::Open, 6, OpenMem, true},
+	{4, Term::End, OperandGrammar::Accept, Skip, false},
+	{6, Term::Reg32, 7, SetIndex, true},
+	{7, Term::Star, 8, Skip, true},
+	{8, Term::Number, 10, SetScale, true},
+	{10, Term::Close, 9, Skip, true},
+	{9, Term::End, OperandGrammar::Accept, Skip, false}
+};
 
-	int ptr, scale, imm, disp;
-	Lexem reg, base, index;
-	string sreg, name, text;
-	bool valid;
+constexpr OperandGrammar operandGrammar(stage7Operand);
+
+constexpr Instruction stage7Instructions[] = {
+	{keyword("STOSD"), {Form::None, Form::None}, 0xAB, -1, Instruction::Plain, Instruction::NoImm},
+	{keyword("DEC"), {Form::R32, Form::None}, 0x48, -1, Instruction::PlusReg, Instruction::NoImm},
+	{keyword("DEC"), {Form::R8, Form::None}, 0xFE, 1, Instruction::ModRM, Instruction::NoImm},
+	{keyword("INC"), {Form::Mem, Form::None}, 0xFF, 0, Instruction::ModRM, Instruction::NoImm},
+	{keyword("XOR"), {Form::R8, Form::R8}, 0x32, -1, Instruction::ModRM, Instruction::NoImm},
+	{keyword("XOR"), {Form::R32, Form::R32}, 0x33, -1, Instruction::ModRM, Instruction::NoImm},
+	{keyword("OR"), {Form::R8, Form::Mem}, 0x0A, -1, Instruction::ModRM, Instruction::NoImm},
+	{keyword("OR"), {Form::R32, Form::Mem}, 0x0B, -1, Instruction::ModRM, Instruction::NoImm},
+	{keyword("AND"), {Form::Mem, Form::R8}, 0x20, -1, Instruction::ModRM, Instruction::NoImm},
+	{keyword("AND"), {Form::Mem, Form::R32}, 0x21, -1, Instruction::ModRM, Instruction::NoImm},
+	{keyword("MOV"), {Form::R8, Form::Imm}, 0xB0, -1, Instruction::PlusReg, Instruction::Imm8},
+	{keyword("MOV"), {Form::R32, Form::Imm}, 0xB8, -1, Instruction::PlusReg, Instruction::Imm32},
+	{keyword("ADC"), {Form::Mem, Form::Imm}, 0x81, 2, Instruction::ModRM, Instruction::ImmPtr},
+	{keyword("JZ"), {Form::Label, Form::None}, 0x74, -1, Instruction::Jump, Instruction::NoImm}
+};
 
-	Operand(const Info &info, const vector<Lexem> &lexems) : type(Type::Undef), valid(true), info(info), lexems(lexems) {}
+constexpr InstructionSet isa(stage7Instructions);
 
-	bool lookup() {
-		ptr = scale = imm = disp = 0;
-		reg = base = index = Lexem();
+struct Operand : Descriptor {
+	// Its lexems in the token stream; info is relative to the sentence.
+	int first, count;
+	Info info;
 
-		int i = 0, len = lexems.size();
+	Operand(const Info &info, int first, int count) : first(first), count(count), info(info) {}
 
-		if ((i < len) && (lexems[i].type == Lexem::Type::PtrType)) {
-			string ptr = lexems[i++].text;
+	bool lookup(const Tokens &tokens) {
+		static_cast<Descriptor &>(*this) = operandGrammar.parse(tokens.terms.data() + first, count);
+		return valid;
+	}
 
-			if ((i < len) && (lexems[i].type == Lexem::Type::Operator)) {
-				i++;
-				if (ptr.compare("byte") == 0) {
-					this->ptr = 1;
-				} else if (ptr.compare("dword") == 0) {
-					this->ptr = 4;
-				} else return valid = false;
-			} else return valid = false;
-			goto is_mem;
-		}
-
-		if ((i < len) && ((lexems[i].type == Lexem::Type::Reg8) || (lexems[i].type == Lexem::Type::Reg32))) {
-			type = Type::Reg;
-			this->reg = lexems[i++];
-			return valid = i == len;
-		} else if ((i < len) && (lexems[i].type == Lexem::Type::Number)) {
-			type = Type::Imm;
-			this->imm = stol(lexems[i++].text, 0, 16);
-			return valid = i == len;
-		} else if ((i < len) && (lexems[i].type == Lexem::Type::String)) {
-			type = Type::Text;
-			this->text = lexems[i++].text;
-			return valid = i == len;
-		}
-
-		is_mem:
-		if ((i < len) && (lexems[i].type == Lexem::Type::SReg)) {
-			const Lexem &sreg = lexems[i++];
-			if ((i < len) && (lexems[i].text.compare("[") == 0)) {
-				i++;
-				this->sreg = sreg.text;
-			} else return valid = i == len;
+	// Its form for the instruction table. An operand that is not there is
+	// Form::None, one that did not parse has no form.
+	unsigned form() const {
+		if (count == 0) return Form::None;
+		if (!valid) return 0;
+		switch (kind) {
+			case Reg: return reg.type == Term::Reg8 ? Form::R8 : reg.type == Term::Reg16 ? Form::R16 : Form::R32;
+			case Imm: return Form::Imm;
+			case Mem: return Form::Mem;
+			case Name: return Form::Label;
+			default: return 0;
 		}
-
-		if ((i < len) && (lexems[i].type == Lexem::Type::Identifier)) {
-			type = Type::Name;
-			this->name = lexems[i++].text;
-			if ((i < len) && (lexems[i].text.compare("[") == 0)) {
-				type = Type::Mem;
-				i++;
-				if ((i < len) && (lexems[i].type == Lexem::Type::Reg32)) {
-					this->index = lexems[i++];
-					if ((i < len) && (lexems[i].text.compare("*") == 0)) {
-						i++;
-						if ((i < len) && (lexems[i].type == Lexem::Type::Number)) {
-							this->scale = stol(lexems[i++].text, 0, 16);
-							if ((i < len) && (lexems[i].text.compare("]"))) i++;
-							return i == len;
-						} else return valid = false;
-					} else return valid = false;
-				} else return valid = false;
-			}
-		} else return valid = false;
 	}
 
 	bool isreg() {
-		return type == Type::Reg;
+		return kind == Reg;
 	}
 
 	bool ismem() {
-		return type == Type::Mem;
+		return kind == Mem;
 	}
 
 	bool isimm() {
-		return type == Type::Imm;
+		return kind == Imm;
 	}
 
 	bool istext() {
-		return type == Type::Text;
+		return kind == Text;
 	}
 
 	bool isname() {
-		return type == Type::Name;
+		return kind == Name;
 	}
 };
 
+// A reference from the code of a sentence to a symbol. The symbol's offset
+// plus addend goes into the field at site of that code, less the end of the
+// instruction for a relative reference. The field of a short jump is a byte.
+// size is the one the code took for a variable not defined yet, else 0.
+struct Fixup {
+	int symbol, addend, line;
+	unsigned char site, size;
+	bool relative, rel8;
+
+	Fixup() : symbol(-1), addend(0), line(0), site(0), size(0), relative(false), rel8(false) {}
+};
+
+// Lives in the arena, as does everything it points to but the source line
+// and the EQU texts.
 struct Sentence {
-	string prefix, bytes, source;
-	bool printable, valid, skip;
+	string_view prefix;
+	string_view source;
+	Span<Splice> splices;
+	// restart is set on a SEGMENT, which takes the offset back to 0.
+	bool printable, valid, skip, restart;
+	// Its code is [offset, offset + length) of the segment's. The length is
+	// known once it is looked up, the offset once the sentences are laid out.
+	int segment;
 	unsigned offset, length;
+	// The code until it is emitted, and the reference in it.
+	Span<unsigned char> code;
+	Fixup fixup;
 
 	Info label, name, mnemo;
-	vector<Operand> operands;
-	vector<Lexem> lexems;
+	Span<Operand> operands;
+	// Its lexems in the token stream. Positions above count from first.
+	int first, count;
 
-	Sentence(const string &source, const vector<Lexem> lexems) : skip(false), valid(true), source(source), lexems(lexems), label(-1, 0), name(-1, 0), mnemo(-1, 0), printable(false), offset(0) {
-		length = 0;
-		int len = lexems.size(), i = 0;
+	Sentence(Arena &arena, const Tokens &tokens, const string_view &source, int first, int count) : source(source), printable(false), valid(true), skip(false), restart(false), segment(-1), offset(0), length(0), label(-1, 0), name(-1, 0), mnemo(-1, 0), first(first), count(count) {
+		const Token::Type *types = tokens.types.data() + first;
+		int len = count, i = 0;
 
-		if ((i < len) && (lexems[i].type == Lexem::Identifier)) {
+		if ((i < len) && (types[i] == Token::Identifier)) {
 			int index = i++;
-			if ((i < len) && (lexems[i].text.compare(":") == 0)) {
+			if ((i < len) && tokens.is(first + i, ':')) {
 				this->label.index = index;
 				i++;
 			} else {
@@ -286,140 +555,900 @@ struct Sentence {
 			}
 		}
 
-		if ((i < len) && ((lexems[i].type == Lexem::Directive) || (lexems[i].type == Lexem::DataType) || (lexems[i].type == Lexem::Command))) {
+		if ((i < len) && ((types[i] == Token::Directive) || (types[i] == Token::DataType) || (types[i] == Token::Command))) {
 			this->mnemo.index = i++;
 		}
 
+		int parts = i < len ? 1 : 0;
+		for (int j = i; j < len; j++) {
+			if (tokens.is(first + j, ',')) parts++;
+		}
+		operands = arena.allocate<Operand>(max(parts, 2));
+
+		parts = 0;
 		while (i < len) {
-			vector<Lexem> operand_lexems;
-			int index = i;
+			int index = i, size = 0;
 			while (i < len) {
-				if (lexems[i].text.compare(",") == 0) {
+				if (tokens.is(first + i, ',')) {
 					i++;
 					break;
 				}
-				operand_lexems.push_back(lexems[i++]);
+				size++, i++;
 			}
-			Operand operand(Info(index, i - index), operand_lexems);
-			valid &= operand.lookup();
-			operands.push_back(operand);
+			Operand *operand = new (&operands[parts++]) Operand(Info(index, i - index), first + index, size);
+			valid &= operand->lookup(tokens);
+		}
+
+		while (parts < operands.size()) {
+			new (&operands[parts++]) Operand(Info(-1, 0), first + len, 0);
+		}
+	}
+
+	// The listing text: the source line with EQUs substituted.
+	void printText(Writer &file) const {
+		int copied = 0;
+		for (auto &splice : splices) {
+			file.put(source.substr(copied, splice.begin - copied));
+			file.put(splice.text);
+			copied = splice.end;
+		}
+		file.put(source.substr(copied));
+	}
+
+	// The label or variable it defines, -1 for none.
+	int defines(const Tokens &tokens) const {
+		if (!valid) return -1;
+		if (label.index != -1) return tokens.terms[first + label.index].symbol;
+		if ((name.index != -1) && (mnemo.index != -1) && (tokens.types[first + mnemo.index] == Token::DataType)) {
+			return tokens.terms[first + name.index].symbol;
+		}
+		return -1;
+	}
+
+	bool lookup(struct Assembler *);
+	void printAnalyze(Writer &, const Tokens &);
+	void printOffset(Writer &, const unsigned char *);
+};
+
+// Gives every identifier a dense id, case-insensitively. The folded names are
+// stored back to back in one string and found through an open-addressing
+// table, so looking a name up never allocates.
+struct Interner {
+	vector<unsigned> slots, hashes, offsets;
+	string names;
+
+	Interner() : slots(64, 0), offsets(1, 0) {}
+
+	// Forgets every name and keeps the room.
+	void clear() {
+		fill(slots.begin(), slots.end(), 0);
+		hashes.clear();
+		offsets.resize(1);
+		names.clear();
+	}
+
+	static unsigned hash(const string_view &text) {
+		unsigned hash = 0x811C9DC5;
+		for (char c : text) hash = (hash ^ upcase(c)) * 0x01000193;
+		return hash;
+	}
+
+	unsigned size() const {
+		return hashes.size();
+	}
+
+	string_view name(unsigned id) const {
+		return string_view(names).substr(offsets[id], offsets[id + 1] - offsets[id]);
+	}
+
+	bool equals(unsigned id, const string_view &text) const {
+		string_view name = this->name(id);
+		if (name.size() != text.size()) return false;
+		for (size_t i = 0; i < text.size(); i++) {
+			if (name[i] != upcase(text[i])) return false;
 		}
+		return true;
+	}
 
-		while (operands.size() < 2) {
-			operands.push_back(Operand(Info(-1, 0), {}));
+	// Ids ordered by name, for the tables at the end of the listing.
+	vector<unsigned> sorted() const {
+		vector<unsigned> order(size());
+		for (unsigned id = 0; id < size(); id++) order[id] = id;
+		sort(order.begin(), order.end(), [this](unsigned a, unsigned b) { return name(a) < name(b); });
+		return order;
+	}
+
+	// Slot holding text, or the empty slot where it would go.
+	unsigned probe(const string_view &text, unsigned hash) const {
+		unsigned mask = slots.size() - 1, slot = hash & mask;
+		while (slots[slot] && ((hashes[slots[slot] - 1] != hash) || !equals(slots[slot] - 1, text))) {
+			slot = (slot + 1) & mask;
 		}
+		return slot;
+	}
+
+	int find(const string_view &text) const {
+		unsigned slot = probe(text, hash(text));
+		return slots[slot] ? slots[slot] - 1 : -1;
 	}
 
-	bool lookup(struct Compiler *);
-	void printAnalyze(FILE *);
-	void printOffset(FILE *);
+	unsigned intern(const string_view &text) {
+		unsigned hash = this->hash(text), slot = probe(text, hash);
+		if (slots[slot]) return slots[slot] - 1;
+
+		unsigned id = size();
+		for (char c : text) names += upcase(c);
+		offsets.push_back(names.size());
+		hashes.push_back(hash);
+		slots[slot] = id + 1;
+
+		if (2 * size() > slots.size()) {
+			slots.assign(2 * slots.size(), 0);
+			for (unsigned i = 0; i < size(); i++) {
+				unsigned mask = slots.size() - 1, slot = hashes[i] & mask;
+				while (slots[slot]) slot = (slot + 1) & mask;
+				slots[slot] = i + 1;
+			}
+		}
+		return id;
+	}
+};
+
+// Read-only mapping of a whole source file. Lexems and sentences keep views
+// into it, so it has to outlive them.
+struct Source {
+	const char *data;
+	size_t size;
+
+	Source() : data(nullptr), size(0) {}
+	Source(const Source &) = delete;
+	Source &operator=(const Source &) = delete;
+	~Source() { close(); }
+
+	bool open(const string &filename) {
+		close();
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd == -1) return false;
+		struct stat info;
+		if ((fstat(fd, &info) == 0) && (info.st_size > 0)) {
+			void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapping != MAP_FAILED) {
+				madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+				data = (const char *)mapping;
+				size = info.st_size;
+			}
+		}
+		::close(fd);
+		return true;
+	}
+
+	void close() {
+		if (data) munmap((void *)data, size);
+		data = nullptr;
+		size = 0;
+	}
+};
+
+// Appends the lexems of a line, with no symbols yet: names are interned in
+// source order by the semantic pass. Safe on any thread. Returns whether the
+// line had a character the lexer rejects.
+bool lex(const string_view &line, Tokens &lexems) {
+	Lexer lexer(stage7, line);
+	for (Token token; lexer.next(token);) {
+		lexems.push(token, Term::of(token, token.keyword == -1 ? 0 : stage7.keywords[token.keyword].code));
+	}
+	return lexer.error;
+}
+
+// A run of whole lines of the source and their lexems. Line i is lines[i],
+// its lexems [firsts[i], firsts[i + 1]), and errors[i] whether the lexer
+// rejected a character of it.
+struct Chunk {
+	const char *begin, *end;
+	Tokens lexems;
+	vector<string_view> lines;
+	vector<int> firsts;
+	vector<char> errors;
+
+	Chunk(const char *begin, const char *end) : begin(begin), end(end) {}
+
+	void lex() {
+		for (const char *at = begin; at < end;) {
+			const char *stop = (const char *)memchr(at, '\n', end - at);
+			string_view line(at, stop ? stop - at : end - at);
+			at += line.size() + 1;
+
+			firsts.push_back(lexems.size());
+			lines.push_back(line);
+			errors.push_back(::lex(line, lexems));
+		}
+		firsts.push_back(lexems.size());
+	}
+
+	void release() {
+		lexems = Tokens();
+		lines = vector<string_view>();
+		firsts = vector<int>();
+		errors = vector<char>();
+	}
+};
+
+// Lexes the chunks of a source on worker threads while the semantic pass
+// takes them in order. Workers stay at most Window chunks ahead of it, so
+// memory holds a few chunks however long the source is.
+struct LexPool {
+	enum { ChunkSize = 1 << 20 };
+
+	vector<Chunk> chunks;
+	vector<char> ready;
+	size_t next, taken, window;
+	bool stopping;
+	mutex lock;
+	condition_variable changed;
+	vector<thread> workers;
+
+	LexPool(const char *data, size_t size, unsigned threads) : next(0), taken(0), window(2 * threads), stopping(false) {
+		for (const char *begin = data, *end = data + size; begin < end;) {
+			const char *stop = end;
+			if (end - begin > ChunkSize) {
+				const char *newline = (const char *)memchr(begin + ChunkSize, '\n', end - begin - ChunkSize);
+				if (newline) stop = newline + 1;
+			}
+			chunks.emplace_back(begin, stop);
+			begin = stop;
+		}
+		ready.assign(chunks.size(), 0);
+		threads = min<size_t>(threads, chunks.size());
+		for (unsigned i = 0; i < threads; i++) workers.emplace_back([this] { work(); });
+	}
+	LexPool(const LexPool &) = delete;
+	LexPool &operator=(const LexPool &) = delete;
+	~LexPool() {
+		{
+			lock_guard<mutex> guard(lock);
+			stopping = true;
+		}
+		changed.notify_all();
+		for (auto &worker : workers) worker.join();
+	}
+
+	void work() {
+		unique_lock<mutex> guard(lock);
+		for (;;) {
+			changed.wait(guard, [this] { return stopping || (next == chunks.size()) || (next < taken + window); });
+			if (stopping || (next == chunks.size())) return;
+			size_t i = next++;
+			guard.unlock();
+			chunks[i].lex();
+			guard.lock();
+			ready[i] = 1;
+			changed.notify_all();
+		}
+	}
+
+	// Chunks have to be taken in order, each released before the next.
+	Chunk &take(size_t i) {
+		unique_lock<mutex> guard(lock);
+		changed.wait(guard, [&] { return ready[i] != 0; });
+		return chunks[i];
+	}
+
+	void release(size_t i) {
+		chunks[i].release();
+		{
+			lock_guard<mutex> guard(lock);
+			taken = i + 1;
+		}
+		changed.notify_all();
+	}
+};
+
+// Threads that stay up for the life of the process and run the blocks of
+// Assembler::Parallel, so a pass starts none of its own. One pool serves
+// one assembler at a time.
+struct WorkerPool {
+	vector<thread> workers;
+	mutex lock;
+	condition_variable changed, done;
+	// The work of the current run, its blocks for the workers, the next of
+	// them to take and how many are finished.
+	const function<void(size_t)> *work;
+	size_t blocks, next, finished;
+	bool stopping;
+
+	explicit WorkerPool(unsigned threads) : work(nullptr), blocks(0), next(0), finished(0), stopping(false) {
+		for (unsigned i = 0; i < threads; i++) workers.emplace_back([this] { serve(); });
+	}
+	WorkerPool(const WorkerPool &) = delete;
+	WorkerPool &operator=(const WorkerPool &) = delete;
+	~WorkerPool() {
+		{
+			lock_guard<mutex> guard(lock);
+			stopping = true;
+		}
+		changed.notify_all();
+		for (auto &worker : workers) worker.join();
+	}
+
+	unsigned size() const {
+		return workers.size();
+	}
+
+	void serve() {
+		unique_lock<mutex> guard(lock);
+		for (;;) {
+			changed.wait(guard, [this] { return stopping || (next < blocks); });
+			if (stopping) return;
+			size_t block = next++;
+			guard.unlock();
+			(*work)(block);
+			guard.lock();
+			if (++finished == blocks) done.notify_one();
+		}
+	}
+
+	// Calls run(block) for every block of count but the last on the workers,
+	// the last on this thread, and returns once all are done.
+	void run(size_t count, const function<void(size_t)> &run) {
+		{
+			lock_guard<mutex> guard(lock);
+			work = &run;
+			blocks = count - 1;
+			next = finished = 0;
+		}
+		changed.notify_all();
+		run(count - 1);
+		unique_lock<mutex> guard(lock);
+		done.wait(guard, [this] { return finished == blocks; });
+		blocks = next = 0;
+	}
 };
 
 struct IF { bool value; };
-struct Compiler {
-	map<string, vector<Lexem>> eques;
-	map<string, unsigned> segments;
-	map<string, Symbol> symbols;
-	vector<Sentence> sentences;
+
+// Everything about the file being assembled. Assemblers share nothing but
+// constant tables, so any number of them may run side by side, and reset()
+// readies one for another file without giving back what it allocated.
+struct Assembler {
+	Interner names;
+	vector<Equ> eques;
+	vector<Splice> splices;
+	// The lexems of every sentence, those of a line being read in streaming
+	// mode, and the EQU expansions.
+	Tokens tokens, lexems, expansions;
+	deque<string> texts;
+	vector<int> segments;
+	// Code of every segment, by name id, unless imaging is off: streaming
+	// mode lists the code of each sentence and drops it.
+	vector<vector<unsigned char>> images;
+	bool imaging;
+	// The sentences whose reference waits for every symbol, by name id, and
+	// how many there are. While there are any, a jump may still have to grow,
+	// which moves everything after it, so the sentences cannot be laid out
+	// yet.
+	vector<vector<Sentence *>> fixups;
+	int unresolved;
+	vector<Symbol> symbols;
+	// Sentences assembled and not yet dropped; the ENDS among those not yet
+	// laid out, whose offsets are the lengths of their segments.
+	vector<Sentence *> sentences;
+	vector<Sentence *> closings;
+	Arena ir;
 	string filename, listing;
+	Source source;
+	// Where the sentences laid out so far end.
 	unsigned offset;
 	int lineNumber;
-	string segment;
+	int segment;
+	// Lex, EQU or reference errors; and how many sentences are invalid.
 	bool error;
+	int invalid;
+	// The pool the passes split their work on, and how many threads that
+	// makes with this one; with none they run on this thread alone.
+	WorkerPool *workers;
+	unsigned threads;
+
+	Assembler() : imaging(true), unresolved(0), offset(0), segment(-1), error(false), invalid(0), workers(nullptr), threads(1) {}
 
-	Compiler() : error(false) {}
+	void use(WorkerPool &pool) {
+		workers = &pool;
+		threads = pool.size() + 1;
+	}
 
-	vector<Lexem> divide(string &);
-	void parse(int argc, char *argv[]);
+	void reset();
+	void divide(const Tokens &, int, int, vector<Splice> &);
+	Equ *ResolveEqu(int id);
+	Sentence &assemble(const string_view &, const Tokens &, int, int);
+	Sentence &assemble(const string_view &);
+	bool parse(const string &, const string &);
+	bool stream(int argc, char *argv[]);
 	void printOffsets();
 	void printAnalyze();
+	void printAnalyze(Writer &, Sentence &, int);
+	void printAnalyze(Writer &, int);
+	void printOffsets(Writer &);
+	template<class Printer> void Print(Writer &, const Printer &);
+	void printTables(Writer &);
+	void printMemory(FILE *);
+
+	// The code of a sentence, kept in the arena until it is emitted.
+	void SetCode(Sentence &sentence, const void *code, int size) {
+		if (segment == -1) return;
+		sentence.code = ir.allocate<unsigned char>(size);
+		memcpy(sentence.code.data, code, size);
+	}
+
+	// Keeps the reference in the code of a sentence; one to a symbol that is
+	// not defined yet waits for it.
+	void AddFixup(Sentence &sentence, Fixup fixup) {
+		if (segment == -1) return;
+		fixup.line = lineNumber - 1;
+		sentence.fixup = fixup;
+		unsigned id = fixup.symbol;
+		if (FindSymbol(id)) return;
+		if (id >= fixups.size()) fixups.resize(names.size());
+		fixups[id].push_back(&sentence);
+		unresolved++;
+	}
+
+	// The references to id wait no more, it has just been defined. A variable
+	// has to have the size its references took for it, and a jump cannot go
+	// to another segment.
+	void ResolveFixups(unsigned id) {
+		if ((id >= fixups.size()) || fixups[id].empty()) return;
+		const Symbol &symbol = symbols[id];
+		int size = (symbol.kind == Symbol::Variable) ? symbol.size : 4;
+		for (Sentence *sentence : fixups[id]) {
+			if (sentence->fixup.size && (sentence->fixup.size != size)) Reject(*sentence, "is not of the size taken for it");
+			else if (sentence->fixup.relative && (symbol.segment != sentence->segment)) Reject(*sentence, "is in another segment");
+		}
+		unresolved -= fixups[id].size();
+		fixups[id].clear();
+	}
+
+	// Makes a sentence invalid for its reference, which cannot be filled in,
+	// and drops its code.
+	void Reject(Sentence &sentence, const char *reason) {
+		string_view name = names.name(sentence.fixup.symbol);
+		fprintf(stderr, "%s(%d): %.*s %s\n", filename.c_str(), sentence.fixup.line, (int)name.size(), name.data(), reason);
+		sentence.valid = false;
+		sentence.code = Span<unsigned char>();
+		sentence.length = 0;
+		sentence.fixup = Fixup();
+		invalid++;
+	}
+
+	// What the reference of a laid out sentence has to hold.
+	int FixupValue(const Sentence &sentence) const {
+		const Fixup &fixup = sentence.fixup;
+		unsigned value = FindSymbol(fixup.symbol)->value + fixup.addend;
+		if (fixup.relative) value -= sentence.offset + sentence.length;
+		return value;
+	}
+
+	void Link();
+	void Layout(unsigned);
+	bool Relax();
+	void Grow(Sentence &);
+	void Release();
+	void Emit();
+	size_t Blocks(size_t) const;
+	template<class Work> void Parallel(size_t, const Work &);
+
+	// Reports the references to symbols that were never defined.
+	bool CheckFixups() {
+		bool resolved = true;
+		for (unsigned id = 0; id < fixups.size(); id++) {
+			for (const Sentence *sentence : fixups[id]) {
+				fprintf(stderr, "%s(%d): undefined %.*s\n", filename.c_str(), sentence->fixup.line, (int)names.name(id).size(), names.name(id).data());
+				resolved = false;
+			}
+		}
+		return resolved;
+	}
 
-	bool SetEqu(const string &text, const vector<Lexem> &lexems) {
-		if (eques.find(text) != eques.end()) return false;
-		eques[text] = lexems;
+	// The code of an emitted sentence, null for none.
+	const unsigned char *Code(const Sentence &sentence) const {
+		if ((sentence.segment == -1) || !sentence.printable || !sentence.length) return nullptr;
+		return sentence.code.data;
+	}
+
+	// Lookups never insert: an id that was only seen as a reference has no
+	// entry in the tables below until it is defined. Ids are the interner's,
+	// so the -1 of no symbol is past every table.
+	const Equ *FindEqu(unsigned id) const {
+		return ((id < eques.size()) && eques[id].body.size()) ? &eques[id] : nullptr;
+	}
+	const Symbol *FindSymbol(unsigned id) const {
+		return ((id < symbols.size()) && symbols[id].defined) ? &symbols[id] : nullptr;
+	}
+
+	// The body is copied out of the line, which may not outlive the call.
+	bool SetEqu(unsigned id, int first, int count, const string_view &source) {
+		if ((id >= names.size()) || FindEqu(id) || (count == 0)) return false;
+		if (id >= eques.size()) eques.resize(names.size());
+		texts.emplace_back(source);
+		Equ &equ = eques[id];
+		equ.source = texts.back();
+		equ.body.append(tokens, first, count);
+		for (auto &text : equ.body.texts) {
+			size_t at = text.data() - source.data();
+			if (at <= source.size()) text = equ.source.substr(at, text.size());
+		}
 		return true;
 	}
-	bool AddSymbol(const string &text, const Symbol &symbol) {
-		if (symbols.find(text) != symbols.end()) return false;
-		symbols[text] = symbol;
+	bool AddSymbol(unsigned id, const Symbol &symbol) {
+		if ((id >= names.size()) || FindSymbol(id)) return false;
+		if (id >= symbols.size()) symbols.resize(names.size());
+		symbols[id] = symbol;
+		symbols[id].defined = true;
+		return true;
+	}
+
+	// For tools: the symbol defined by name, null if there is none.
+	const Symbol *FindSymbol(const string_view &name) const {
+		return FindSymbol(names.find(name));
+	}
+
+	// For tools: the offset of a label or variable, or the number of an EQU.
+	bool SymbolValue(const string_view &name, unsigned &value) const {
+		const Symbol *symbol = FindSymbol(name);
+		if (!symbol || (symbol->kind == Symbol::Text)) return false;
+		value = symbol->value;
 		return true;
 	}
 
-	bool BeginSegment(const string &text) {
-		offset = 0;
-		if (!segment.empty()) return false;
-		segment = text;
+	bool BeginSegment(int id) {
+		if (segment != -1) return false;
+		segment = id;
 		return true;
 	}
 
-	bool EndSegment(const string &text, const int &length) {
-		if (segment.empty() || (segment.compare(text) != 0)) return false;
-		segments[text] = length;
-		segment.clear();
+	// The length of the segment is the offset of its ENDS, once laid out.
+	bool EndSegment(unsigned id, Sentence &sentence) {
+		if ((segment == -1) || ((unsigned)segment != id)) return false;
+		if (id >= segments.size()) segments.resize(names.size(), -1);
+		segments[id] = 0;
+		closings.push_back(&sentence);
+		segment = -1;
 		return true;
 	}
 
 	vector<IF> ifTable;
 };
 
-vector<Lexem> Compiler::divide(string &input) {
-	vector<Lexem> lexems;
-	for (int i = 0, index = 0; i < input.size();) {
-		if (input[i] == ';') break;
-		else if (isspace(input[i])) i++;
-		else {
-			Lexem lexem;
-			lexem.index = index++;
-			if (isalpha(input[i])) {
-				lexem.begin = i;
-				while ((i < input.size()) && isalnum(input[i])) {
-					lexem.text += toupper(input[i++]);
-				}
-				lexem.end = i;
-				auto keyword = keywords.find(lexem.text);
-				lexem.type = (keyword == keywords.end()) ? Lexem::Type::Identifier : keyword->second;
-			} else if (isdigit(input[i])) {
-				lexem.begin = i;
-				while ((i < input.size()) && isalnum(input[i])) {
-					lexem.text += toupper(input[i++]);
-				}
-				lexem.end = i;
-				if (toupper(input[i - 1]) == 'H') {
-					lexem.type = Lexem::Type::Number;
-				} else error = true;
-			} else if (isquote(input[i])) {
-				char c = input[i++];
-				lexem.begin = i;
-				while ((i < input.size()) && (input[i] != '\'') && (input[i] != '\n')) {
-					lexem.text += input[i++];
-				}
-				lexem.end = i;
-				error = (input[i++] != c);
-				lexem.type = Lexem::Type::String;
-			} else if (isonechar(input[i])) {
-				lexem.type = Lexem::Type::OneChar;
-				lexem.begin = i;
-				lexem.text = input[i++];
-				lexem.end = i;
-			} else {
-				lexem.begin = i++;
-				lexem.end = i;
-				error = true;
+// Blocks of count items for Parallel: one per thread, none smaller than
+// MinBlock, so that a small count stays on this thread.
+size_t Assembler::Blocks(size_t count) const {
+	const size_t MinBlock = 16 * 1024;
+	return max<size_t>(1, min<size_t>(threads, count / MinBlock));
+}
+
+// Calls work(block, first, last) for every block of [0, count), each block
+// but the last on a thread of the pool.
+template<class Work>
+void Assembler::Parallel(size_t count, const Work &work) {
+	size_t blocks = Blocks(count);
+	if (blocks == 1) {
+		work(0, 0, count);
+		return;
+	}
+	workers->run(blocks, [&](size_t block) {
+		work(block, count * block / blocks, count * (block + 1) / blocks);
+	});
+}
+
+// Lays out the sentences held, which every reference in them allows, and
+// emits their code. Jumps start short and grow until each reaches its target;
+// the sentences are laid out again once they have.
+void Assembler::Link() {
+	unsigned start = offset;
+	Layout(start);
+	if (Relax()) Layout(start);
+	for (Sentence *sentence : closings) {
+		segments[sentence->segment] = sentence->offset;
+	}
+	closings.clear();
+	Emit();
+}
+
+// Gives the sentences held their offsets, from start, and the labels and
+// variables among them their values. The offset of a sentence is the sum of
+// the lengths before it, back to the SEGMENT that restarts at 0: a scan that
+// each thread does on a block of sentences, every block starting from the
+// end of the one before.
+void Assembler::Layout(unsigned start) {
+	size_t count = sentences.size(), blocks = Blocks(count);
+	// The end of every block, counted from its last restart if it has one.
+	vector<unsigned> ends(blocks);
+	vector<char> restarts(blocks);
+	Parallel(count, [&](size_t block, size_t first, size_t last) {
+		unsigned end = 0;
+		for (size_t i = first; i < last; i++) {
+			if (sentences[i]->restart) end = 0, restarts[block] = true;
+			end += sentences[i]->length;
+		}
+		ends[block] = end;
+	});
+
+	vector<unsigned> starts(blocks);
+	for (size_t block = 0; block < blocks; block++) {
+		starts[block] = start;
+		start = restarts[block] ? ends[block] : start + ends[block];
+	}
+	offset = start;
+
+	Parallel(count, [&](size_t block, size_t first, size_t last) {
+		unsigned at = starts[block];
+		for (size_t i = first; i < last; i++) {
+			Sentence &sentence = *sentences[i];
+			if (sentence.restart) at = 0;
+			sentence.offset = at;
+			at += sentence.length;
+			int id = sentence.defines(tokens);
+			if (id != -1) symbols[id].value = sentence.offset;
+		}
+	});
+}
+
+// Makes near every short jump held whose target is out of its reach. A jump
+// that grows moves the code after it up to the next restart, which may put
+// other jumps out of reach: only those whose span covers it are checked
+// again. A short jump spans little code, so they are the ones within Reach
+// bytes of it in its run, found by binary search. A jump into another run of
+// its segment, one opened again, is checked once those settle, until none
+// grows. Offsets come from the layout plus the growth before them in the
+// run, counted in a Fenwick tree. Returns whether any grew, as the layout is
+// then stale.
+bool Assembler::Relax() {
+	const unsigned Reach = 136;
+	size_t count = sentences.size(), blocks = Blocks(count);
+	// The short jumps to symbols defined, and those already to grow.
+	vector<vector<size_t>> shorts(blocks), starts(blocks);
+	Parallel(count, [&](size_t block, size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			const Sentence &sentence = *sentences[i];
+			if (!sentence.fixup.rel8) continue;
+			const Symbol *target = FindSymbol(sentence.fixup.symbol);
+			if (!target) continue;
+			shorts[block].push_back(i);
+			int value = FixupValue(sentence);
+			if ((value < -128) || (value > 127)) starts[block].push_back(i);
+		}
+	});
+	deque<size_t> worklist;
+	for (auto &block : starts) worklist.insert(worklist.end(), block.begin(), block.end());
+	if (worklist.empty()) return false;
+
+	// The restart every sentence counts from, count for none, and the
+	// sentence that defines every symbol held.
+	vector<size_t> runs(count);
+	vector<int> definers(symbols.size(), -1);
+	for (size_t i = 0, run = count; i < count; i++) {
+		if (sentences[i]->restart) run = i;
+		runs[i] = run;
+		int id = sentences[i]->defines(tokens);
+		if (id != -1) definers[id] = i;
+	}
+
+	vector<size_t> jumps, foreign;
+	for (auto &block : shorts) {
+		for (size_t i : block) {
+			int target = definers[sentences[i]->fixup.symbol];
+			if (runs[i] == (target == -1 ? count : runs[target])) jumps.push_back(i);
+			else foreign.push_back(i);
+		}
+	}
+
+	vector<unsigned> tree(count + 1);
+	// Jumps grown before sentence i.
+	auto grown = [&](size_t i) {
+		unsigned sum = 0;
+		for (; i; i -= i & (0 - i)) sum += tree[i];
+		return sum;
+	};
+	auto at = [&](size_t i) {
+		return sentences[i]->offset + 4 * (grown(i) - (runs[i] == count ? 0 : grown(runs[i])));
+	};
+	auto reaches = [&](size_t i) {
+		const Sentence &jump = *sentences[i];
+		int target = definers[jump.fixup.symbol];
+		unsigned to = target == -1 ? FindSymbol(jump.fixup.symbol)->value : at(target);
+		int value = to + jump.fixup.addend - (at(i) + jump.length);
+		return (value >= -128) && (value <= 127);
+	};
+
+	while (!worklist.empty()) {
+		while (!worklist.empty()) {
+			size_t grow = worklist.front();
+			worklist.pop_front();
+			if (!sentences[grow]->fixup.rel8) continue;
+			Grow(*sentences[grow]);
+			for (size_t i = grow + 1; i <= count; i += i & (0 - i)) tree[i]++;
+
+			unsigned offset = at(grow);
+			auto near = partition_point(jumps.begin(), jumps.end(), [&](size_t i) {
+				return (i < grow) && ((runs[i] != runs[grow]) || (at(i) + Reach < offset));
+			});
+			for (; (near != jumps.end()) && (runs[*near] == runs[grow]) && (at(*near) <= offset + Reach); near++) {
+				if (sentences[*near]->fixup.rel8 && !reaches(*near)) worklist.push_back(*near);
+			}
+		}
+		for (size_t i : foreign) {
+			if (sentences[i]->fixup.rel8 && !reaches(i)) worklist.push_back(i);
+		}
+	}
+	return true;
+}
+
+// Makes a short jump near: 0F and the opcode of the near form, then rel32.
+void Assembler::Grow(Sentence &jump) {
+	unsigned char opcode = jump.code[0];
+	ir.phase = Arena::Lookup;
+	jump.code = ir.allocate<unsigned char>(6);
+	memset(jump.code.data, 0, 6);
+	jump.code[0] = 0x0F;
+	jump.code[1] = opcode + 0x10;
+	jump.fixup.site = 2;
+	jump.fixup.rel8 = false;
+	jump.length = 6;
+}
+
+// Lets the sentences held be laid out while references in them still wait.
+// Their code goes out before the symbols are known, so nothing could fill in
+// the references: every sentence with one is an error.
+void Assembler::Release() {
+	for (auto &waiting : fixups) {
+		for (Sentence *sentence : waiting) Reject(*sentence, "is not defined within the streaming window");
+		waiting.clear();
+	}
+	unresolved = 0;
+}
+
+// Fills in the references in the code of the sentences held and, when
+// imaging, copies it to the segments, once the layout is final. Each
+// sentence has its own place, so blocks of them go on threads of their own;
+// but a segment opened again starts over at 0 and its code overwrites what
+// was there, which has to happen in order.
+void Assembler::Emit() {
+	// The segments with code in every run of sentences from a restart.
+	vector<int> opened;
+	int run = -1;
+	bool reopened = false;
+	if (imaging) {
+		if (images.size() < names.size()) images.resize(names.size());
+		for (Sentence *sentence : sentences) {
+			if (sentence->restart) run = -1;
+			if ((sentence->segment == -1) || sentence->code.empty()) continue;
+			if (run != sentence->segment) {
+				reopened |= find(opened.begin(), opened.end(), sentence->segment) != opened.end();
+				opened.push_back(run = sentence->segment);
+			}
+			vector<unsigned char> &image = images[sentence->segment];
+			if (image.size() < sentence->offset + sentence->length) image.resize(sentence->offset + sentence->length);
+		}
+	}
+
+	auto emit = [&](size_t, size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			Sentence &sentence = *sentences[i];
+			if (sentence.code.empty()) continue;
+			if (FindSymbol(sentence.fixup.symbol)) {
+				int value = FixupValue(sentence);
+				unsigned char *field = sentence.code.data + sentence.fixup.site;
+				for (int j = 0; j < (sentence.fixup.rel8 ? 1 : 4); j++) field[j] = value >> (8 * j);
+			}
+			if (imaging) memcpy(images[sentence.segment].data() + sentence.offset, sentence.code.data, sentence.length);
+		}
+	};
+	if (reopened) emit(0, 0, sentences.size());
+	else Parallel(sentences.size(), emit);
+}
+
+void Assembler::reset() {
+	names.clear();
+	eques.clear();
+	splices.clear();
+	tokens.clear();
+	lexems.clear();
+	expansions.clear();
+	texts.clear();
+	segments.clear();
+	images.clear();
+	imaging = true;
+	fixups.clear();
+	unresolved = 0;
+	symbols.clear();
+	sentences.clear();
+	closings.clear();
+	ir.reset();
+	filename.clear();
+	listing.clear();
+	source.close();
+	offset = 0;
+	lineNumber = 0;
+	segment = -1;
+	error = false;
+	invalid = 0;
+	ifTable.clear();
+}
+
+// Expands the EQU id once. Returns null for an EQU that refers to itself,
+// directly or through others.
+Equ *Assembler::ResolveEqu(int id) {
+	Equ &equ = eques[id];
+	if (equ.state == Equ::Resolved) return &equ;
+	if (equ.state != Equ::Unresolved) {
+		equ.state = Equ::Recursive;
+		return nullptr;
+	}
+
+	equ.state = Equ::Resolving;
+	bool nested = false;
+	for (const Term &term : equ.body.terms) {
+		if (FindEqu(term.symbol)) {
+			if (!ResolveEqu(term.symbol)) {
+				eques[id].state = Equ::Recursive;
+				return nullptr;
 			}
+			nested = true;
+		}
+	}
 
-			if (lexem.type == Lexem::Type::Identifier) {
-				const auto &equ = eques.find(lexem.text);
-				if (equ != eques.end()) {
-					input = input.replace(lexem.begin, lexem.text.size(), symbols[lexem.text].text);
-					for (Lexem lexem : equ->second) {
-						lexem.index = index++;
-						lexems.push_back(lexem);
-					}
-				} else lexems.push_back(lexem);
-			} else lexems.push_back(lexem);
+	Equ &resolved = eques[id];
+	resolved.first = expansions.size();
+	if (nested) {
+		string text;
+		const Tokens &body = resolved.body;
+		int base = body.begins[0], copied = base;
+		for (int i = 0; i < body.size(); i++) {
+			if (const Equ *inner = FindEqu(body.terms[i].symbol)) {
+				text.append(resolved.source.substr(copied - base, body.begins[i] - copied)).append(inner->text);
+				copied = body.ends[i];
+				expansions.append(expansions, inner->first, inner->count);
+			} else expansions.append(body, i, 1);
 		}
+		text.append(resolved.source.substr(copied - base));
+		texts.push_back(move(text));
+		resolved.text = texts.back();
+	} else {
+		expansions.append(resolved.body, 0, resolved.body.size());
+		resolved.text = resolved.source;
+	}
+	resolved.count = expansions.size() - resolved.first;
+	resolved.state = Equ::Resolved;
+	return &resolved;
+}
+
+// Moves the lexems [first, first + count) of a line to the sentences, naming
+// their identifiers and replacing every use of an EQU with its expansion. The
+// body of an EQU definition is kept as written.
+void Assembler::divide(const Tokens &lexems, int first, int count, vector<Splice> &splices) {
+	int start = tokens.size();
+	bool definition = false;
+	splices.clear();
+	for (int i = first; i < first + count; i++) {
+		if ((i == first + 1) && (lexems.keywords[i] == keyword("EQU")) && (tokens.types[start] == Token::Identifier)) {
+			definition = true;
+		}
+
+		if (lexems.types[i] != Token::Identifier) {
+			tokens.append(lexems, i, 1);
+			continue;
+		}
+
+		int symbol = names.intern(lexems.texts[i]);
+		if (!definition && FindEqu(symbol)) {
+			if (const Equ *equ = ResolveEqu(symbol)) {
+				splices.push_back({lexems.begins[i], lexems.ends[i], equ->text});
+				tokens.append(expansions, equ->first, equ->count);
+				continue;
+			}
+			error = true;
+		}
+		tokens.append(lexems, i, 1);
+		tokens.terms.back().symbol = symbol;
 	}
-	return lexems;
 }
 
 int GetSizeOfImm(int type, int imm) {
@@ -434,83 +1463,190 @@ int GetSizeOfImm(int type, int imm) {
 	return ((-128 <= imm) && (imm < 128)) ? 1 : 4;
 }
 
-int GetSizeOfDisp(int disp) {
-	return ((0x80 <= disp) && (disp < 0xFF80) || (0x10000 <= disp) && (disp < 0xFFFF80) || (0x1000000 <= disp) && (disp < 0xFFFFFF80)) ? 4 : 1;
+// Segment override prefixes by segment register code.
+constexpr unsigned char segmentPrefixes[] = {0x26, 0x2E, 0x36, 0x3E, 0x64, 0x65};
+
+// Segment register an address through reg defaults to, -1 for none.
+int GetDefRegSeg(const Register &reg) {
+	if (reg.is(Term::Reg32, code("ESP")) || reg.is(Term::Reg32, code("EBP"))) 
+		return code("SS");
+	else if (reg.type == Term::Reg32) return code("DS");
+	else return -1;
 }
 
-string GetDefRegSeg(const Lexem &reg) {
-	string text = reg.text;
-	if ((text.compare("esp") == 0) || (text.compare("ebp") == 0) || (text.compare("sp") == 0) || (text.compare("bp") == 0)) 
-		return "ss";
-	else if (reg.type == Lexem::Type::Reg32) return "ds";
-	else return "";
+// Bytes a memory operand addresses: the PTR type, else the size of the
+// variable it names; 0 if that is not defined yet.
+int GetSizeOfMemory(const Operand &memory, const Assembler *view) {
+	if (memory.ptr) return memory.ptr;
+	const Symbol *symbol = view->FindSymbol(memory.symbol);
+	if (!symbol && (memory.symbol != -1)) return 0;
+	if (symbol && (symbol->kind == Symbol::Variable)) return symbol->size;
+	return 4;
 }
 
-bool Sentence::lookup(Compiler *view) {
+// Bytes of a general register.
+int GetSizeOfRegister(const Register &reg) {
+	return reg.type == Term::Reg8 ? 1 : reg.type == Term::Reg16 ? 2 : 4;
+}
+
+void PutValue(unsigned char *bytes, int &length, unsigned value, int size) {
+	for (int i = 0; i < size; i++) bytes[length++] = value >> (8 * i);
+}
+
+// Encodes an instruction into bytes, which has room for the longest one.
+// Returns its length, -1 for operands it cannot encode. fixup is set to the
+// reference to a variable or label, if there is one, and its field is left 0
+// until the sentences are laid out.
+int Encode(const Instruction &instruction, const Operand *operands, const Assembler *view, unsigned char *bytes, Fixup &fixup) {
+	const Operand *memory = nullptr, *immediate = nullptr, *reg = nullptr, *rm = nullptr;
+	for (int i = 0; i < 2; i++) {
+		if (operands[i].kind == Operand::Mem) memory = rm = &operands[i];
+		if (operands[i].kind == Operand::Imm) immediate = &operands[i];
+		if (operands[i].kind == Operand::Reg) {
+			if (!reg && (instruction.ext == -1)) reg = &operands[i];
+			else rm = &operands[i];
+		}
+	}
+
+	int length = 0, size = 4;
+	unsigned char opcode = instruction.opcode;
+	if (memory) {
+		const Register &sreg = memory->sreg;
+		int segment = memory->base.present() ? GetDefRegSeg(memory->base) : code("DS");
+		if (sreg.present() && (sreg.code != segment)) bytes[length++] = segmentPrefixes[sreg.code];
+		size = GetSizeOfMemory(*memory, view);
+		// A variable not defined yet takes the size of the register, else a
+		// dword; its definition is checked against that.
+		if (!size) fixup.size = size = reg ? GetSizeOfRegister(reg->reg) : 4;
+		// A register operand fixes the size, the memory has to agree.
+		if (reg && (size != GetSizeOfRegister(reg->reg))) return -1;
+		if (size == 2) bytes[length++] = 0x66;
+		// Without a register the w bit of the opcode gives the size.
+		if ((size == 1) && !reg) opcode &= ~1;
+	}
+
+	int immSize = 0;
+	switch (instruction.imm) {
+		case Instruction::NoImm: break;
+		case Instruction::Imm8:
+			if (GetSizeOfImm(1, immediate->imm) == -1) return -1;
+			immSize = 1;
+			break;
+		case Instruction::Imm32: immSize = 4; break;
+		case Instruction::ImmPtr:
+			immSize = GetSizeOfImm(size, immediate->imm & 0xFFFFFFFF);
+			if (immSize == -1) return -1;
+			// The s bit: a byte sign-extended to the operand.
+			if ((size != 1) && (immSize == 1)) opcode |= 2;
+			break;
+	}
+
+	switch (instruction.encoding) {
+		case Instruction::Plain:
+			bytes[length++] = opcode;
+			break;
+		case Instruction::PlusReg:
+			bytes[length++] = opcode + operands[0].reg.code;
+			break;
+		case Instruction::ModRM: {
+			bytes[length++] = opcode;
+			int field = reg ? reg->reg.code : instruction.ext;
+			if (!memory) {
+				bytes[length++] = 0xC0 | (field << 3) | rm->reg.code;
+				break;
+			}
+			if (memory->index.present()) {
+				const int scales[] = {-1, 0, 1, -1, 2, -1, -1, -1, 3};
+				int scale = ((memory->scale > 0) && (memory->scale <= 8)) ? scales[memory->scale] : -1;
+				if ((scale == -1) || (memory->index.code == code("ESP"))) return -1;
+				bytes[length++] = (field << 3) | 4/*sib*/;
+				bytes[length++] = (scale << 6) | (memory->index.code << 3) | 5/*no base*/;
+			} else bytes[length++] = (field << 3) | 5/*disp32*/;
+			fixup.symbol = memory->symbol;
+			fixup.addend = memory->disp;
+			fixup.site = length;
+			PutValue(bytes, length, 0, 4);
+			break;
+		}
+		case Instruction::Jump: {
+			const Symbol *target = view->FindSymbol(operands[0].symbol);
+			fixup.symbol = operands[0].symbol;
+			fixup.relative = true;
+			// Nothing in another segment can be reached. Short, the layout
+			// makes it near if it does not reach.
+			if (target && target->isOffset() && (target->segment != view->segment)) return -1;
+			bytes[length++] = opcode;
+			fixup.site = length;
+			fixup.rel8 = true;
+			bytes[length++] = 0;
+			return length;
+		}
+	}
+
+	if (immSize) PutValue(bytes, length, immediate->imm, immSize);
+	return length;
+}
+
+bool Sentence::lookup(Assembler *view) {
 	if (view->error) return valid = false;
 
-	int len = lexems.size();
+	const Tokens &tokens = view->tokens;
+	const Term *terms = tokens.terms.data() + first;
+	int len = count;
 
 	if (label.index != -1) {
-		if (!view->AddSymbol(lexems[label.index].text, Symbol(view->segment, format(" %.4X ", view->offset), "L NEAR"))) {
+		if (!view->AddSymbol(terms[label.index].symbol, Symbol(Symbol::Label, view->segment, 0))) {
 			return valid = false;
 		}
+		view->ResolveFixups(terms[label.index].symbol);
 		printable = true;
 	} else if (mnemo.index != -1) {
-		auto &mnemocode = lexems[mnemo.index];
+		int mnemocode = tokens.keywords[first + mnemo.index];
+		Token::Type mnemotype = tokens.types[first + mnemo.index];
 		if (name.index != -1) {
-			if (mnemocode.text.compare("SEGMENT") == 0) {
-				if (!view->BeginSegment(lexems[name.index].text)) return valid = false;
+			if (mnemocode == keyword("SEGMENT")) {
+				restart = true;
+				if (!view->BeginSegment(terms[name.index].symbol)) return valid = false;
 				printable = true;
-			} else if (mnemocode.text.compare("ENDS") == 0) {
-				if (!view->EndSegment(lexems[name.index].text, view->offset)) return valid = false;
+			} else if (mnemocode == keyword("ENDS")) {
+				if (!view->EndSegment(terms[name.index].symbol, *this)) return valid = false;
 				printable = true;
-			} else if (mnemocode.text.compare("EQU") == 0) {
-				vector<Lexem> equ;
-				int i = mnemo.index + 1;
-				if (i < len) {
-					while (i < len) {
-						equ.push_back(lexems[i++]);
-					}
-				} else return false;
-				int count = equ.size();
+			} else if (mnemocode == keyword("EQU")) {
+				int at = first + mnemo.index + 1, size = len - mnemo.index - 1;
+				if (size == 0) return valid = false;
 
 				Symbol symbol;
-				symbol.text = source.substr(equ[0].begin, equ[count - 1].end);
-				if ((count == 1) && (equ[0].type == Lexem::Number)) {
-					symbol.type = "NUMBER";
-					symbol.value = format("%.4X", stol(symbol.text, 0, 16));
-					prefix = format(" = %s ", symbol.value.c_str());
-				} else if (count > 0) {
-					symbol.type = "TEXT";
-					symbol.value = symbol.text;
+				string_view text = source.substr(tokens.begins[at], tokens.ends[at + size - 1] - tokens.begins[at]);
+				if ((size == 1) && (tokens.types[at] == Token::Number)) {
+					symbol = Symbol(Symbol::Number, -1, tokens.terms[at].value);
+					char text[12] = " = ";
+					char *end = toHex<4>(text + 3, symbol.value);
+					*end++ = ' ';
+					prefix = view->ir.copy(string_view(text, end - text));
+				} else {
+					symbol = Symbol(Symbol::Text, -1, 0);
 					prefix = " =     ";
-				} else return valid = false;
-				if (!view->AddSymbol(lexems[name.index].text, symbol)) return valid = false;
-				if (!view->SetEqu(lexems[name.index].text, equ)) return valid = false;
-			} else if (mnemocode.type == Lexem::DataType) {
-				Symbol symbol;
-				symbol.value = format(" %.4X ", view->offset);
-				symbol.segment = view->segment;
+				}
+				if (!view->AddSymbol(terms[name.index].symbol, symbol)) return valid = false;
+				if (!view->SetEqu(terms[name.index].symbol, at, size, text)) return valid = false;
+			} else if (mnemotype == Token::DataType) {
+				Symbol symbol(Symbol::Variable, view->segment, 0, stage7.keywords[mnemocode].code);
 
-				if (mnemocode.text.compare("DB") == 0) {
-					symbol.type = "L BYTE";
+				if (mnemocode == keyword("DB")) {
 					if (operands[0].valid) {
 						if (operands[0].istext()) {
-							length = operands[0].text.size();
+							length = tokens.texts[operands[0].first + operands[0].text].size();
 						} else if (operands[0].isimm()) {
 							length = 1;
 						} else return valid = false;
 					} else return valid = false;
-				} else if (mnemocode.text.compare("DW") == 0) {
-					symbol.type = "L WORD";
+				} else if (mnemocode == keyword("DW")) {
 					if (operands[0].valid) {
 						if (operands[0].isimm()) {
 							length = 2;
 						} else return valid = false;
 					} else return valid = false;
-				} else if (mnemocode.text.compare("DD") == 0) {
-					symbol.type = "L DWORD";
+				} else if (mnemocode == keyword("DD")) {
 					if (operands[0].valid) {
 						if (operands[0].isimm()) {
 							length = 4;
@@ -518,102 +1654,47 @@ bool Sentence::lookup(Compiler *view) {
 					} else return valid = false;
 				} 
 
-				if (!view->AddSymbol(lexems[name.index].text, symbol)) {
+				if (!view->AddSymbol(terms[name.index].symbol, symbol)) {
 					return valid = false;
 				}
+				view->ResolveFixups(terms[name.index].symbol);
+				if (operands[0].istext()) {
+					view->SetCode(*this, tokens.texts[operands[0].first + operands[0].text].data(), length);
+				} else {
+					unsigned char code[4];
+					int size = 0;
+					PutValue(code, size, operands[0].imm, length);
+					view->SetCode(*this, code, size);
+				}
 				printable = true;
 			}
-		} else if (mnemocode.text.compare("IF") == 0) {
+		} else if (mnemocode == keyword("IF")) {
 			if (operands[0].isimm()) {
 				IF context;
 				context.value = operands[0].imm;
 				skip = !context.value;
 				view->ifTable.push_back(context);
 			} else return valid = false;
-		} else if (mnemocode.text.compare("ENDIF") == 0) {
+		} else if (mnemocode == keyword("ENDIF")) {
 			if (view->ifTable.empty()) return valid = false;
 			skip = !view->ifTable.back().value;
 			view->ifTable.pop_back();
 		} else if (!view->ifTable.empty() && !view->ifTable.back().value) {
 			skip = true;
-		} else if (mnemocode.text.compare("END") == 0) {
+		} else if (mnemocode == keyword("END")) {
 
-		} else if (mnemocode.type == Lexem::Command) {
+		} else if (mnemotype == Token::Command) {
 			printable = true;
-
-			if (mnemocode.text.compare("STOSD") == 0) {
-				length = 1;
-			} else if (mnemocode.text.compare("DEC") == 0) {
-				if (!operands[0].isreg()) return valid = false;
-				length = 1;
-			} else if (mnemocode.text.compare("INC") == 0) {
-				if (!operands[0].ismem()) return valid = false;
-				Lexem &index = operands[1].index;
-				string &sreg = operands[1].sreg;
-
-				length = 1/*instr*/ + 1/*mod*/ + 1/*sib*/ + 4/*ident*/;
-
-				if (!sreg.empty() && !sreg.compare(GetDefRegSeg(index)) || GetDefRegSeg(index).compare("ds") || view->segment.compare(view->symbols[operands[1].text].segment)) {
-					//length += 1;
-				}
-			} else if (mnemocode.text.compare("XOR") == 0) {
-				if (operands[0].isreg() && operands[1].isreg()) {
-					if (operands[0].reg.type == operands[1].reg.type) {
-						length = 2;
-					} else return valid = false;
-				} else return valid = false;
-			} else if (mnemocode.text.compare("OR") == 0) {
-				if (operands[0].isreg() && operands[1].ismem()) {
-					const Lexem &reg = operands[0].reg;
-					Lexem &index = operands[1].index;
-					string &sreg = operands[1].sreg;
-
-					length = 1/*instr*/ + 1/*mod*/ + 1/*sib*/ + 4/*ident*/;
-
-					if (!sreg.empty() && !sreg.compare(GetDefRegSeg(index)) || GetDefRegSeg(index).compare("ds") || view->segment.compare(view->symbols[operands[1].text].segment)) {
-						// length += 1;
-					}
-				} else return valid = false;
-			} else if (mnemocode.text.compare("AND") == 0) {
-				if (operands[0].isimm() && operands[1].isreg()) {
-					const Lexem &reg = operands[0].reg;
-					const string &sreg = operands[1].sreg;
-					Lexem &index = operands[1].index;
-
-					length = 1/*instr*/ + 1/*mod*/ + 1/*sib*/ + 4/*ident*/;
-
-					if (!sreg.empty() && !sreg.compare(GetDefRegSeg(index)) || GetDefRegSeg(index).compare("ds") || view->segment.compare(view->symbols[operands[1].text].segment)) {
-						// length += 1;
-					}
-				} else return valid = false;
-			} else if (mnemocode.text.compare("MOV") == 0) {
-				if (operands[0].isreg() && operands[1].isimm()) {
-					length = 1 + GetSizeOfImm(operands[0].lexems[0].type == Lexem::Type::Reg8 ? 1 : 4, operands[1].imm & 0xFFFFFFFF); 
-				} else return valid = false;
-			} else if (mnemocode.text.compare("ADC") == 0) {
-				if (operands[0].ismem() && operands[1].isimm()) {
-					length = 1/*instr*/ + 1/*mod*/ + 1/*sib*/ + 4/*ident*/ + GetSizeOfImm(operands[0].ptr, operands[1].imm & 0xFFFFFFFF); 
-				} else return valid = false;
-			} else if (mnemocode.text.compare("JZ") == 0) {
-				if (operands[0].valid) {
-					if (operands[0].ismem()) {
-						Lexem &index = operands[1].index;
-						string &sreg = operands[1].sreg;
-
-						length = 1/*instr*/ + 1/*mod*/ + 1/*sib*/ + 4/*ident*/;
-
-						if (!sreg.empty() && !sreg.compare(GetDefRegSeg(index)) || GetDefRegSeg(index).compare("ds") || view->segment.compare(view->symbols[operands[1].text].segment)) {
-							// length += 1;
-						}
-					} else if (operands[0].isname()) {
-						string &sreg = operands[1].sreg;
-
-						length = view->symbols.find(operands[1].name) != view->symbols.end() ? 2 : 6;
-
-						// if (!sreg.empty() && sreg.compare("ds")) length += 1;
-					} else return valid = false;
-				} return valid = false;
-			}		
+			if (operands.size() > 2) return valid = false;
+			const Instruction *instruction = isa.find(mnemocode, operands[0].form(), operands[1].form());
+			if (!instruction) return valid = false;
+			unsigned char code[16];
+			Fixup fixup;
+			int size = Encode(*instruction, operands.data, view, code, fixup);
+			if (size == -1) return valid = false;
+			length = size;
+			view->SetCode(*this, code, size);
+			if (fixup.symbol != -1) view->AddFixup(*this, fixup);
 		}
 	} else if ((name.index != -1) || !operands.empty()) {
 		return valid = false;
@@ -621,106 +1702,482 @@ bool Sentence::lookup(Compiler *view) {
 	return true;
 }
 
-void Sentence::printAnalyze(FILE *file) {
+void Sentence::printAnalyze(Writer &file, const Tokens &tokens) {
 	if (source.empty()) return;
-	fprintf(file, " Label  Mnemocode  1st operand  2nd operand\n");
-	fprintf(file, " index    index    index count  index count\n");
-
-	fprintf(file, " %5i  %9i  %5i %5i  %5i %5i\n\n", label.index & name.index, mnemo.index, operands[0].info.index, operands[0].info.count, operands[1].info.index, operands[1].info.count);	
-	int index = 0;
-	for (auto &lexem : lexems) {
-		fprintf(file, "%-2d | %11s | %2i | %16s |\n", index++, lexem.text.c_str(), lexem.text.size(), getinfo(lexem.type).c_str());
+	file.put(" Label  Mnemocode  1st operand  2nd operand\n");
+	file.put(" index    index    index count  index count\n");
+
+	file.put(' '), file.dec(label.index & name.index, 5);
+	file.put("  "), file.dec(mnemo.index, 9);
+	file.put("  "), file.dec(operands[0].info.index, 5);
+	file.put(' '), file.dec(operands[0].info.count, 5);
+	file.put("  "), file.dec(operands[1].info.index, 5);
+	file.put(' '), file.dec(operands[1].info.count, 5);
+	file.put("\n\n");
+	for (int index = 0; index < count; index++) {
+		const string_view &text = tokens.texts[first + index];
+		Token::Type type = tokens.types[first + index];
+		int size = text.size();
+		file.dec(index, -2);
+		file.put(" | ");
+		file.fill(' ', 11 - size);
+		char *to = file.reserve(size);
+		for (char c : text) *to++ = type == Token::String ? c : upcase(c);
+		file.size += size;
+		file.put(" | "), file.dec(size, 2);
+		file.put(" | "), file.put(getinfo(type), 16);
+		file.put(" |\n");
 	}
-	fprintf(file, "\n");
+	file.put('\n');
 }
 
-void Sentence::printOffset(FILE *file) {
+// bytes is the code of the sentence, null for none.
+void Sentence::printOffset(Writer &file, const unsigned char *bytes) {
 	if (skip) return;
 
+	int width;
 	if (printable) {
-		fprintf(file, " %.4X ", offset);
+		file.put(' ');
+		width = file.hex<4>(offset) + 2;
+		file.put(' ');
 	} else if (!prefix.empty()) {
-		fprintf(file, prefix.c_str());
-	} else fprintf(file, "    ");
+		file.put(prefix);
+		width = prefix.size();
+	} else {
+		file.put("    ");
+		width = 4;
+	}
 
-	fprintf(file, "\t\t%s\n", source.c_str());
+	if (bytes) {
+		char *to = file.reserve(3 * length);
+		for (unsigned i = 0; i < length; i++) {
+			*to++ = ' ';
+			*to++ = hexDigits.pairs[bytes[i]][0];
+			*to++ = hexDigits.pairs[bytes[i]][1];
+		}
+		file.size += 3 * length;
+		width += 3 * length;
+	}
+	file.fill(' ', 40 - width);
+	file.put('\t');
+	printText(file);
+	file.put('\n');
+}
+
+// Runs one line through both passes and adds it to the sentences, which
+// gives it its length; Link gives it its offset. The sentence stays valid
+// until the arena is reset.
+Sentence &Assembler::assemble(const string_view &line, const Tokens &lexems, int from, int count) {
+	lineNumber ++;
+	int first = tokens.size();
+	ir.phase = Arena::Lex;
+	divide(lexems, from, count, splices);
+	Span<Splice> line_splices = ir.copy(splices);
+
+	ir.phase = Arena::Parse;
+	Sentence &sentence = *new (ir.allocate<Sentence>(1).data) Sentence(ir, tokens, line, first, tokens.size() - first);
+	sentence.splices = line_splices;
+
+	ir.phase = Arena::Lookup;
+	sentences.push_back(&sentence);
+	sentence.segment = segment;
+	sentence.lookup(this);
+	if (!sentence.valid) invalid++;
+	return sentence;
 }
 
-void Compiler::parse(int argc, char *argv[]) {
-	if (argc > 1) filename = argv[1];
-	auto pos = filename.find_last_of(".");
-	cout << "Source filename[.asm]: " << filename;
-	if (argc <= 1) while (!getline(cin, filename)); else cout << endl;
-	if (filename.find_last_of(".") == string::npos) filename += ".asm";
+Sentence &Assembler::assemble(const string_view &line) {
+	lexems.clear();
+	error |= lex(line, lexems);
+	return assemble(line, lexems, 0, lexems.size());
+}
 
-	if (argc > 2) listing = argv[2];
-	cout << "Source listing[.lst]: " << listing;
-	if (argc <= 2) getline(cin, listing); else cout << endl;
-	if (listing.find_last_of(".") == string::npos) listing += ".lst";
-	cout << endl;
+// Assembles a source file, to be listed in listing. A name without an
+// extension gets .asm or .lst. Returns false if the source cannot be read.
+bool Assembler::parse(const string &filename, const string &listing) {
+	this->filename = filename;
+	if (filename.find_last_of(".") == string::npos) this->filename += ".asm";
+	this->listing = listing;
+	if (listing.find_last_of(".") == string::npos) this->listing += ".lst";
 
 	ifTable.clear();
 
 	lineNumber = 0;
-	string line;
-	ifstream file(filename);
+	invalid = 0;
 	offset = 0;
-	while (getline(file, line)) {
-		lineNumber ++;
-		const auto &lexems = divide(line);
-		Sentence sentence(line, lexems);
-		sentence.lookup(this);
-		sentence.offset = offset;
-		offset += sentence.length;
-		sentences.push_back(sentence);
-	}
-	file.close();
-}
-
-void Compiler::printAnalyze() {
-	FILE *file = fopen((filename.substr(0, filename.find_last_of(".")) + ".lex").c_str(), "w");
-	int lineNumber = 0;
-	for (auto &sentence : sentences) {
-		fprintf(file, " %s\n", sentence.source.c_str());
-		if (sentence.valid) {
-			sentence.printAnalyze(file);
-		} else {
-			fprintf(file, "%s(%d): error\n", filename.c_str(), lineNumber);
+	if (!source.open(this->filename)) return false;
+
+	// Lexing needs nothing from the lines before, the rest of a line does;
+	// that includes a lex error, which fails every line from its own on.
+	LexPool pool(source.data, source.size, threads);
+	for (size_t i = 0; i < pool.chunks.size(); i++) {
+		const Chunk &chunk = pool.take(i);
+		for (size_t line = 0; line < chunk.lines.size(); line++) {
+			error |= chunk.errors[line] != 0;
+			assemble(chunk.lines[line], chunk.lexems, chunk.firsts[line], chunk.firsts[line + 1] - chunk.firsts[line]);
 		}
-		lineNumber++;
+		pool.release(i);
 	}
-	fclose(file);
+	error |= !CheckFixups();
+	Link();
+	return true;
 }
 
-void Compiler::printOffsets() {
-	FILE *file = fopen(listing.c_str(), "w");
-	int lineNumber = 0;
-	for (auto &sentence : sentences) {
-		sentence.printOffset(file);
-		// if (!sentence.valid) fprintf(file, "%s(%d): error\n", filename.c_str(), lineNumber);
-		lineNumber++;
+// Streaming mode: "-s [source [listing]]", where a missing name or "-" means
+// stdin or stdout. Every line is written out as soon as it is assembled and
+// then dropped, code and all, so memory holds only the tables. The analysis
+// goes next to a named source, as in the default mode. Fails if the source
+// cannot be read or has an error, as batch mode does.
+bool Assembler::stream(int argc, char *argv[]) {
+	filename = ((argc > 1) && strcmp(argv[1], "-")) ? argv[1] : "";
+	listing = ((argc > 2) && strcmp(argv[2], "-")) ? argv[2] : "";
+
+	FILE *in = filename.empty() ? stdin : fopen(filename.c_str(), "r");
+	if (!in) {
+		fprintf(stderr, "%s: cannot open\n", filename.c_str());
+		return false;
+	}
+	unique_ptr<Writer> lst(listing.empty() ? new Writer(STDOUT_FILENO) : new Writer(listing));
+	unique_ptr<Writer> lex(filename.empty() ? nullptr : new Writer(filename.substr(0, filename.find_last_of(".")) + ".lex"));
+	if (lst->fd == -1) {
+		fprintf(stderr, "%s: cannot create\n", listing.c_str());
+		if (in != stdin) fclose(in);
+		return false;
 	}
 
-	fprintf(file, "\n\n                N a m e         	Size	Length\n\n");
-	for (auto &segment : segments) {
-		fprintf(file, "%-32s\t%-7s\t%-.4X\n", segment.first.c_str(), "32 Bit", segment.second);
+	ifTable.clear();
+	lineNumber = 0;
+	invalid = 0;
+	offset = 0;
+	imaging = false;
+
+	// The sentences wait to be laid out while a reference is unresolved, as
+	// a jump may still grow and move them; the line itself is copied to the
+	// arena for that. At most Window of them wait, then those whose reference
+	// still waits are errors and the sentences go out regardless.
+	const size_t Window = 16 * 1024;
+	int first = 0;
+	auto flush = [&](bool all) {
+		if (unresolved && !all) {
+			if (sentences.size() < Window) return;
+			Release();
+		}
+		Link();
+		if (lex) printAnalyze(*lex, first);
+		printOffsets(*lst);
+		first += sentences.size();
+		sentences.clear();
+		ir.reset();
+		tokens.clear();
+	};
+
+	char *buffer = nullptr;
+	size_t capacity = 0;
+	for (ssize_t size; (size = getline(&buffer, &capacity, in)) != -1;) {
+		string_view line(buffer, size);
+		if (!line.empty() && (line.back() == '\n')) line.remove_suffix(1);
+
+		ir.phase = Arena::Lex;
+		assemble(ir.copy(line));
+		flush(false);
+	}
+	free(buffer);
+	error |= !CheckFixups();
+	flush(true);
+	printTables(*lst);
+
+	if (in != stdin) fclose(in);
+	return !error && !invalid;
+}
+
+void Assembler::printAnalyze(Writer &file, Sentence &sentence, int lineNumber) {
+	file.put(' ');
+	sentence.printText(file);
+	file.put('\n');
+	if (sentence.valid) {
+		sentence.printAnalyze(file, tokens);
+	} else {
+		file.put(filename), file.put('('), file.dec(lineNumber), file.put("): error\n");
+	}
+}
+
+// Renders the sentences held into file with print(writer, i). Rounds of them
+// are split into blocks, each rendered on a thread of its own into a buffer,
+// and the buffers go to the file in order.
+template<class Printer>
+void Assembler::Print(Writer &file, const Printer &print) {
+	size_t count = sentences.size(), round = 64 * 1024 * threads;
+	if (Blocks(count) == 1) {
+		for (size_t i = 0; i < count; i++) print(file, i);
+		return;
+	}
+	vector<Writer> buffers(threads);
+	for (size_t base = 0; base < count; base += round) {
+		size_t size = min(round, count - base), blocks = Blocks(size);
+		Parallel(size, [&](size_t block, size_t first, size_t last) {
+			buffers[block].size = 0;
+			for (size_t i = first; i < last; i++) print(buffers[block], base + i);
+		});
+		for (size_t block = 0; block < blocks; block++) file.append(buffers[block]);
+	}
+}
+
+// The analysis of the sentences held, the first of them on line first.
+void Assembler::printAnalyze(Writer &file, int first) {
+	Print(file, [&](Writer &to, size_t i) { printAnalyze(to, *sentences[i], first + i); });
+}
+
+void Assembler::printOffsets(Writer &file) {
+	Print(file, [&](Writer &to, size_t i) { sentences[i]->printOffset(to, Code(*sentences[i])); });
+}
+
+void Assembler::printAnalyze() {
+	Writer file(filename.substr(0, filename.find_last_of(".")) + ".lex");
+	printAnalyze(file, 0);
+}
+
+void Assembler::printOffsets() {
+	Writer file(listing);
+	printOffsets(file);
+	printTables(file);
+}
+
+void Assembler::printTables(Writer &file) {
+	file.put("\n\n                N a m e         	Size	Length\n\n");
+	const vector<unsigned> order = names.sorted();
+	for (unsigned id : order) {
+		if ((id < segments.size()) && (segments[id] != -1)) {
+			file.put(names.name(id), -32), file.put('\t');
+			file.put("32 Bit", -7), file.put('\t');
+			file.hex<4>(segments[id]), file.put('\n');
+		}
 	}
 	
-	fprintf(file, "\nSymbols:\n                N a m e         	Type	 Value	 Attr\n");
-	for (auto symbol : symbols) {
-		fprintf(file, "%-32s\t%-7s\t%-s\t%s\n", symbol.first.c_str(), symbol.second.type.c_str(), symbol.second.value.c_str(), symbol.second.segment.c_str());
+	file.put("\nSymbols:\n                N a m e         	Type	 Value	 Attr\n");
+	for (unsigned id : order) {
+		const Symbol *symbol = FindSymbol(id);
+		if (!symbol) continue;
+
+		const char *type = "";
+		switch (symbol->kind) {
+			case Symbol::Label: type = "L NEAR"; break;
+			case Symbol::Variable: type = symbol->size == 1 ? "L BYTE" : symbol->size == 2 ? "L WORD" : "L DWORD"; break;
+			case Symbol::Number: type = "NUMBER"; break;
+			case Symbol::Text: type = "TEXT"; break;
+		}
+		file.put(names.name(id), -32), file.put('\t');
+		file.put(type, -7), file.put('\t');
+		if (symbol->isOffset()) {
+			file.put(' '), file.hex<4>(symbol->value), file.put(' ');
+		} else if (symbol->kind == Symbol::Number) {
+			file.hex<4>(symbol->value);
+		} else if (const Equ *equ = FindEqu(id)) {
+			file.put(equ->source);
+		}
+		file.put('\t');
+		if (symbol->segment != -1) file.put(names.name(symbol->segment));
+		file.put('\n');
 	}
-	fprintf(file, "\n");
-	fclose(file);
+	file.put('\n');
 }
 
+// Bytes of IR each phase allocated, and what the arena holds for them.
+void Assembler::printMemory(FILE *file) {
+	const char *phases[] = {"lex", "parse", "lookup"};
+	size_t total = 0;
+	for (int phase = 0; phase < Arena::Phases; phase++) {
+		fprintf(file, "%-8s%12zu bytes\n", phases[phase], ir.allocated[phase]);
+		total += ir.allocated[phase];
+	}
+	fprintf(file, "%-8s%12zu bytes\n", "total", total);
+	fprintf(file, "%-8s%12zu bytes in %zu blocks\n", "arena", ir.reserved(), ir.blocks.size());
+	fprintf(file, "%-8s%12zu bytes\n", "tokens", tokens.bytes());
+}
+
+// Runs run(job) for every job on threads. Each thread has a queue of its
+// own, dealt the jobs in turn from the largest down; it takes the front of
+// its queue and, once that is empty, steals the front of another's. The
+// largest job left is always the next one taken, so sources of millions of
+// lines start first and those of a few lines fill in around them.
+template<class Run>
+void RunJobs(const vector<size_t> &sizes, unsigned threads, const Run &run) {
+	struct Queue {
+		mutex lock;
+		deque<size_t> jobs;
+	};
+
+	vector<size_t> order(sizes.size());
+	for (size_t job = 0; job < order.size(); job++) order[job] = job;
+	stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+	threads = max<size_t>(1, min<size_t>(threads, order.size()));
+	vector<Queue> queues(threads);
+	for (size_t i = 0; i < order.size(); i++) queues[i % threads].jobs.push_back(order[i]);
+
+	auto take = [&](unsigned self, size_t &job) {
+		for (unsigned i = 0; i < threads; i++) {
+			Queue &queue = queues[(self + i) % threads];
+			lock_guard<mutex> guard(queue.lock);
+			if (queue.jobs.empty()) continue;
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+			return true;
+		}
+		return false;
+	};
+
+	vector<thread> workers;
+	for (unsigned self = 0; self < threads; self++) {
+		workers.emplace_back([&, self] {
+			for (size_t job; take(self, job);) run(self, job);
+		});
+	}
+	for (auto &worker : workers) worker.join();
+}
+
+// Batch mode: "-b [-j threads] path...", where a path is a source or a
+// directory searched for .asm files. Every source gets its listing and
+// analysis next to it, as in the default mode; the sources are assembled
+// side by side, each on one thread. Fails if any of them does.
+bool batch(int argc, char *argv[]) {
+	unsigned threads = max(1u, thread::hardware_concurrency());
+	int first = 1;
+	if ((argc > 2) && (strcmp(argv[1], "-j") == 0)) {
+		threads = max(1, atoi(argv[2]));
+		first = 3;
+	}
+
+	vector<string> sources;
+	for (int i = first; i < argc; i++) {
+		error_code error;
+		if (!filesystem::is_directory(argv[i], error)) {
+			sources.push_back(argv[i]);
+			continue;
+		}
+		vector<string> found;
+		for (auto &entry : filesystem::recursive_directory_iterator(argv[i], error)) {
+			string extension = entry.path().extension().string();
+			transform(extension.begin(), extension.end(), extension.begin(), upcase);
+			if (entry.is_regular_file(error) && (extension == ".ASM")) found.push_back(entry.path().string());
+		}
+		sort(found.begin(), found.end());
+		sources.insert(sources.end(), found.begin(), found.end());
+	}
+
+	vector<size_t> sizes(sources.size());
+	for (size_t i = 0; i < sources.size(); i++) {
+		error_code error;
+		sizes[i] = filesystem::file_size(sources[i], error);
+		if (error) sizes[i] = 0;
+	}
+
+	// One assembler per thread, reset between its sources. It has no pool:
+	// its passes stay on its thread, the others are busy with sources too.
+	vector<unique_ptr<Assembler>> assemblers(threads);
+	atomic<bool> failed(false);
+	RunJobs(sizes, threads, [&](unsigned self, size_t job) {
+		const string &source = sources[job];
+		if (!assemblers[self]) assemblers[self].reset(new Assembler);
+		Assembler &assembler = *assemblers[self];
+		assembler.reset();
+		if (!assembler.parse(source, source.substr(0, source.find_last_of(".")) + ".lst")) {
+			fprintf(stderr, "%s: cannot open\n", assembler.filename.c_str());
+			failed = true;
+			return;
+		}
+		assembler.printAnalyze();
+		assembler.printOffsets();
+		if (assembler.error || assembler.invalid) failed = true;
+	});
+	return !failed;
+}
+
+// Stress mode: "-t [-j threads] [-n rounds] source". Every thread assembles
+// the source rounds times with one assembler, reset in between, and checks
+// that the listing and the analysis come out as they do from an assembler
+// using every core. Fails on any difference. Meant for a build with
+// -fsanitize=thread.
+bool stress(int argc, char *argv[]) {
+	unsigned threads = max(1u, thread::hardware_concurrency());
+	int rounds = 16, first = 1;
+	for (; (first + 1 < argc) && (argv[first][0] == '-'); first += 2) {
+		if (strcmp(argv[first], "-j") == 0) threads = max(1, atoi(argv[first + 1]));
+		else if (strcmp(argv[first], "-n") == 0) rounds = max(1, atoi(argv[first + 1]));
+		else return false;
+	}
+	if (first >= argc) return false;
+	string source = argv[first];
+
+	auto render = [&](Assembler &assembler, Writer &lex, Writer &lst) {
+		assembler.reset();
+		if (!assembler.parse(source, "")) return false;
+		assembler.printAnalyze(lex, 0);
+		assembler.printOffsets(lst);
+		assembler.printTables(lst);
+		return true;
+	};
+	auto same = [](const Writer &a, const Writer &b) {
+		return string_view(a.buffer, a.size) == string_view(b.buffer, b.size);
+	};
+
+	Assembler reference;
+	WorkerPool workers(max(1u, thread::hardware_concurrency()) - 1);
+	reference.use(workers);
+	Writer lex, lst;
+	if (!render(reference, lex, lst)) {
+		fprintf(stderr, "%s: cannot open\n", reference.filename.c_str());
+		return false;
+	}
+
+	vector<size_t> jobs(threads, 1);
+	atomic<int> differences(0);
+	RunJobs(jobs, threads, [&](unsigned, size_t) {
+		Assembler assembler;
+		for (int round = 0; round < rounds; round++) {
+			Writer lexRound, lstRound;
+			if (!render(assembler, lexRound, lstRound) || !same(lex, lexRound) || !same(lst, lstRound)) differences++;
+		}
+	});
+	fprintf(stderr, "%u threads, %d rounds each: %d differ\n", threads, rounds, differences.load());
+	return differences == 0;
+}
+
+// "-m" in front of the other arguments reports the IR memory on stderr. The
+// default mode is "[source [listing]]": test.asm, and a listing named after
+// the source. Every mode exits with 1 if a source cannot be read or has an
+// error.
 int main(int argc, char *argv[]) {
-	argc += 2;
-	argv[1] = &(string("test.asm")[0]);
-	argv[2] = &(string("test.lst")[0]);
-
-	Compiler *compiler = new Compiler;
-	compiler->parse(argc, argv);
-	compiler->printAnalyze();
-	compiler->printOffsets();
-}
\ No newline at end of file
+	if ((argc > 1) && (strcmp(argv[1], "-b") == 0)) {
+		return batch(argc - 1, argv + 1) ? 0 : 1;
+	}
+	if ((argc > 1) && (strcmp(argv[1], "-t") == 0)) {
+		return stress(argc - 1, argv + 1) ? 0 : 1;
+	}
+
+	Assembler assembler;
+	WorkerPool workers(max(1u, thread::hardware_concurrency()) - 1);
+	assembler.use(workers);
+	bool memory = (argc > 1) && (strcmp(argv[1], "-m") == 0);
+	if (memory) {
+		argc--;
+		argv++;
+	}
+
+	int status = 0;
+	if ((argc > 1) && (strcmp(argv[1], "-s") == 0)) {
+		status = assembler.stream(argc - 1, argv + 1) ? 0 : 1;
+	} else {
+		string source = argc > 1 ? argv[1] : "test.asm";
+		string listing = argc > 2 ? argv[2] : source.substr(0, source.find_last_of(".")) + ".lst";
+		if (assembler.parse(source, listing)) {
+			assembler.printAnalyze();
+			assembler.printOffsets();
+			if (assembler.error || assembler.invalid) status = 1;
+		} else {
+			fprintf(stderr, "%s: cannot open\n", assembler.filename.c_str());
+			status = 1;
+		}
+	}
+	if (memory) assembler.printMemory(stderr);
+	return status;
+}
@@ -0,0 +1,87 @@
+using namespace std;
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include "dialects.h"
+
+// Times the shared lexer on every stage's test.asm, scalar against vectorized,
+// and on wide lines of stage 7: deep indentation and long names, the runs the
+// kernels are for. Build from this directory with -O2 (add -mavx2 for the
+// 32-byte kernels) and run it from here: bench [repeat]
+
+struct Stage {
+	const char *name, *path;
+	const Dialect &dialect;
+};
+
+double run(const Dialect &dialect, const vector<string> &lines, bool vectorized, size_t &count) {
+	count = 0;
+	auto start = chrono::steady_clock::now();
+	for (auto &line : lines) {
+		Lexer lexer(dialect, line);
+		lexer.vectorized = vectorized;
+		for (Token token; lexer.next(token);) count++;
+	}
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Lines whose blanks and names run far past the scalar prefix of scan<>().
+vector<string> wide() {
+	const string indent(64, ' '), name(48, 'v');
+	return {
+		indent + "code segment",
+		indent + name + "1 dd 7c7bah",
+		indent + "or edx, " + name + "1[eax * 4h]",
+		indent + "mov " + name + "2, " + name + "3",
+		indent + "code ends"
+	};
+}
+
+int main(int argc, char *argv[]) {
+	int repeat = argc > 1 ? stoi(argv[1]) : 100000;
+	const Stage stages[] = {
+		{"1", "../1/test.asm", stage1},
+		{"2", "../2/test.asm", stage2},
+		{"3", "../3/test.asm", stage3},
+		{"7", "../7/test.asm", stage7},
+		{"7 wide", nullptr, stage7}
+	};
+
+	int status = 0;
+	for (auto &stage : stages) {
+		vector<string> source = stage.path ? vector<string>() : wide(), lines;
+		string line;
+		if (stage.path) {
+			ifstream file(stage.path);
+			while (getline(file, line)) source.push_back(line);
+		}
+
+		size_t bytes = 0;
+		for (int i = 0; i < repeat; i++) {
+			for (auto &text : source) {
+				lines.push_back(text);
+				bytes += text.size() + 1;
+			}
+		}
+
+		// The best of Rounds, taken in turns, as one run is noisy.
+		const int Rounds = 5;
+		size_t scalarCount, vectorCount;
+		double scalar = 1e9, vectorized = 1e9;
+		for (int round = 0; round < Rounds; round++) {
+			scalar = min(scalar, run(stage.dialect, lines, false, scalarCount));
+			vectorized = min(vectorized, run(stage.dialect, lines, true, vectorCount));
+		}
+
+		printf("stage %s: %zu lines, %.1f MB\n", stage.name, lines.size(), bytes / 1e6);
+		printf("  scalar:     %8.3f s  %8.1f MB/s  %zu tokens\n", scalar, bytes / 1e6 / scalar, scalarCount);
+		printf("  vectorized: %8.3f s  %8.1f MB/s  %zu tokens\n", vectorized, bytes / 1e6 / vectorized, vectorCount);
+		if (scalarCount != vectorCount) status = 1;
+	}
+	return status;
+}
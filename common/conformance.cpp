@@ -0,0 +1,92 @@
+using namespace std;
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "dialects.h"
+
+// Checks the shared lexer against the token streams of every stage's test.asm
+// in golden/, which the stages' own lexers produced before it replaced them.
+// A token is a line: its source line, type, text in the case the stage folds
+// it to, and value. The scalar and the vectorized scan both have to match.
+// Build from this directory and run it from here: conformance [write], where
+// write stores the streams as they are now, after a deliberate change.
+
+struct Stage {
+	const char *name, *path, *golden;
+	const Dialect &dialect;
+};
+
+const char *typeNames[] = {
+	"unknown", "one-char", "number", "string", "identifier", "directive", "data-type",
+	"ptr-type", "operator", "reg8", "reg16", "reg32", "sreg", "command"
+};
+
+vector<string> tokens(const Dialect &dialect, const vector<string> &lines, bool vectorized) {
+	vector<string> stream;
+	for (size_t i = 0; i < lines.size(); i++) {
+		Lexer lexer(dialect, lines[i]);
+		lexer.vectorized = vectorized;
+		for (Token token; lexer.next(token);) {
+			string text(token.text);
+			if (token.type != Token::String) {
+				for (char &c : text) c = dialect.fold(c);
+			}
+			stream.push_back(to_string(i + 1) + '\t' + typeNames[token.type] + '\t' + text + '\t' + to_string(token.value));
+		}
+	}
+	return stream;
+}
+
+int main(int argc, char *argv[]) {
+	bool write = (argc > 1) && (string(argv[1]) == "write");
+	const Stage stages[] = {
+		{"1", "../1/test.asm", "golden/1.tokens", stage1},
+		{"2", "../2/test.asm", "golden/2.tokens", stage2},
+		{"3", "../3/test.asm", "golden/3.tokens", stage3},
+		{"7", "../7/test.asm", "golden/7.tokens", stage7}
+	};
+
+	int status = 0;
+	for (auto &stage : stages) {
+		vector<string> lines, golden;
+		string line;
+		ifstream source(stage.path);
+		while (getline(source, line)) lines.push_back(line);
+		source.close();
+		if (lines.empty()) {
+			printf("stage %s: cannot read %s\n", stage.name, stage.path);
+			status = 1;
+			continue;
+		}
+
+		if (write) {
+			ofstream file(stage.golden);
+			for (auto &token : tokens(stage.dialect, lines, false)) file << token << '\n';
+			printf("stage %s: wrote %s\n", stage.name, stage.golden);
+			continue;
+		}
+
+		ifstream file(stage.golden);
+		while (getline(file, line)) golden.push_back(line);
+		file.close();
+
+		for (bool vectorized : {false, true}) {
+			vector<string> stream = tokens(stage.dialect, lines, vectorized);
+			size_t i = 0;
+			while ((i < stream.size()) && (i < golden.size()) && (stream[i] == golden[i])) i++;
+			const char *scan = vectorized ? "vectorized" : "scalar";
+			if ((i == stream.size()) && (i == golden.size())) {
+				printf("stage %s, %s: %zu tokens match\n", stage.name, scan, i);
+				continue;
+			}
+			printf("stage %s, %s: token %zu differs\n", stage.name, scan, i + 1);
+			printf("  expected: %s\n", i < golden.size() ? golden[i].c_str() : "(end)");
+			printf("  got:      %s\n", i < stream.size() ? stream[i].c_str() : "(end)");
+			status = 1;
+		}
+	}
+	return status;
+}
@@ -0,0 +1,229 @@
+#ifndef DIALECTS_H
+#define DIALECTS_H
+
+// Keyword sets and lexical rules of each stage. Register codes are the
+// numbers x86 encodes them with.
+
+#include "lexer.h"
+
+constexpr Keyword stage1Keywords[] = {
+	{"ASSUME", Token::Directive, 0},
+	{"END", Token::Directive, 0},
+	{"SEGMENT", Token::Directive, 0},
+	{"ENDS", Token::Directive, 0},
+	{"EQU", Token::Directive, 0},
+	{"IF", Token::Directive, 0},
+	{"ELSE", Token::Directive, 0},
+	{"ENDIF", Token::Directive, 0},
+
+	{"DB", Token::DataType, 1},
+	{"DW", Token::DataType, 2},
+	{"DD", Token::DataType, 4},
+
+	{"BYTE", Token::PtrType, 1},
+	{"DWORD", Token::PtrType, 4},
+	{"PTR", Token::Operator, 0},
+
+	{"EAX", Token::Reg32, 0},
+	{"EBX", Token::Reg32, 3},
+	{"ECX", Token::Reg32, 1},
+	{"EDX", Token::Reg32, 2},
+	{"ESI", Token::Reg32, 6},
+	{"EDI", Token::Reg32, 7},
+	{"ESP", Token::Reg32, 4},
+	{"EBP", Token::Reg32, 5},
+
+	{"AH", Token::Reg8, 4},
+	{"BH", Token::Reg8, 7},
+	{"CH", Token::Reg8, 5},
+	{"DH", Token::Reg8, 6},
+	{"AL", Token::Reg8, 0},
+	{"BL", Token::Reg8, 3},
+	{"CL", Token::Reg8, 1},
+	{"DL", Token::Reg8, 2},
+
+	{"CS", Token::SReg, 1},
+	{"DS", Token::SReg, 3},
+	{"SS", Token::SReg, 2},
+	{"ES", Token::SReg, 0},
+	{"FS", Token::SReg, 4},
+	{"GS", Token::SReg, 5},
+
+	{"PUSHA", Token::Command, 0},
+	{"INC", Token::Command, 0},
+	{"DEC", Token::Command, 0},
+	{"XCHG", Token::Command, 0},
+	{"LEA", Token::Command, 0},
+	{"AND", Token::Command, 0},
+	{"MOV", Token::Command, 0},
+	{"OR", Token::Command, 0},
+	{"JB", Token::Command, 0}
+};
+
+constexpr Dialect stage1 = {stage1Keywords, "+-*:,[]", "'", Dialect::RadixSuffix, false, false, true};
+
+constexpr Keyword stage2Keywords[] = {
+	{"END", Token::Directive, 0},
+	{"SEGMENT", Token::Directive, 0},
+	{"ENDS", Token::Directive, 0},
+	{"PROC", Token::Directive, 0},
+	{"ENDP", Token::Directive, 0},
+	{"ASSUME", Token::Directive, 0},
+
+	{"DB", Token::DataType, 1},
+	{"DW", Token::DataType, 2},
+
+	{"FAR", Token::PtrType, -2},
+	{"BYTE", Token::PtrType, 1},
+	{"DWORD", Token::PtrType, 4},
+	{"PTR", Token::Operator, 0},
+
+	{"AH", Token::Reg8, 4},
+	{"BH", Token::Reg8, 7},
+	{"CH", Token::Reg8, 5},
+	{"DH", Token::Reg8, 6},
+	{"AL", Token::Reg8, 0},
+	{"BL", Token::Reg8, 3},
+	{"CL", Token::Reg8, 1},
+	{"DL", Token::Reg8, 2},
+
+	{"AX", Token::Reg16, 0},
+	{"BX", Token::Reg16, 3},
+	{"CX", Token::Reg16, 1},
+	{"DX", Token::Reg16, 2},
+	{"SI", Token::Reg16, 6},
+	{"DI", Token::Reg16, 7},
+	{"SP", Token::Reg16, 4},
+	{"BP", Token::Reg16, 5},
+
+	{"CS", Token::SReg, 1},
+	{"DS", Token::SReg, 3},
+	{"SS", Token::SReg, 2},
+	{"ES", Token::SReg, 0},
+	{"FS", Token::SReg, 4},
+	{"GS", Token::SReg, 5},
+
+	{"RET", Token::Command, 0},
+	{"NOT", Token::Command, 0},
+	{"OR", Token::Command, 0},
+	{"ADD", Token::Command, 0},
+	{"MOV", Token::Command, 0},
+	{"JGE", Token::Command, 0},
+	{"CALL", Token::Command, 0}
+};
+
+constexpr Dialect stage2 = {stage2Keywords, "+:,[]", "'", Dialect::HexDigits, true, true, false};
+
+constexpr Keyword stage3Keywords[] = {
+	{"ASSUME", Token::Directive, 0},
+	{"END", Token::Directive, 0},
+	{"SEGMENT", Token::Directive, 0},
+	{"ENDS", Token::Directive, 0},
+	{"EQU", Token::Directive, 0},
+	{"IF", Token::Directive, 0},
+	{"ELSE", Token::Directive, 0},
+	{"ENDIF", Token::Directive, 0},
+
+	{"DB", Token::DataType, 1},
+	{"DW", Token::DataType, 2},
+	{"DD", Token::DataType, 4},
+
+	{"BYTE", Token::PtrType, 1},
+	{"DWORD", Token::PtrType, 4},
+	{"PTR", Token::Operator, 0},
+
+	{"EAX", Token::Reg32, 0},
+	{"EBX", Token::Reg32, 3},
+	{"ECX", Token::Reg32, 1},
+	{"EDX", Token::Reg32, 2},
+	{"ESI", Token::Reg32, 6},
+	{"EDI", Token::Reg32, 7},
+	{"ESP", Token::Reg32, 4},
+	{"EBP", Token::Reg32, 5},
+
+	{"AH", Token::Reg8, 4},
+	{"BH", Token::Reg8, 7},
+	{"CH", Token::Reg8, 5},
+	{"DH", Token::Reg8, 6},
+	{"AL", Token::Reg8, 0},
+	{"BL", Token::Reg8, 3},
+	{"CL", Token::Reg8, 1},
+	{"DL", Token::Reg8, 2},
+
+	{"CS", Token::SReg, 1},
+	{"DS", Token::SReg, 3},
+	{"SS", Token::SReg, 2},
+	{"ES", Token::SReg, 0},
+	{"FS", Token::SReg, 4},
+	{"GS", Token::SReg, 5},
+
+	{"AAA", Token::Command, 0},
+	{"INC", Token::Command, 0},
+	{"DIV", Token::Command, 0},
+	{"ADD", Token::Command, 0},
+	{"CMP", Token::Command, 0},
+	{"AND", Token::Command, 0},
+	{"IMUL", Token::Command, 0},
+	{"OR", Token::Command, 0},
+	{"JBE", Token::Command, 0}
+};
+
+constexpr Dialect stage3 = {stage3Keywords, "+-*:,[]", "'", Dialect::RadixSuffix, false, false, true};
+
+constexpr Keyword stage7Keywords[] = {
+	{"ASSUME", Token::Directive, 0},
+	{"END", Token::Directive, 0},
+	{"SEGMENT", Token::Directive, 0},
+	{"ENDS", Token::Directive, 0},
+	{"EQU", Token::Directive, 0},
+	{"IF", Token::Directive, 0},
+	{"ENDIF", Token::Directive, 0},
+
+	{"DB", Token::DataType, 1},
+	{"DW", Token::DataType, 2},
+	{"DD", Token::DataType, 4},
+
+	{"BYTE", Token::PtrType, 1},
+	//{"WORD", Token::PtrType, 2},
+	{"DWORD", Token::PtrType, 4},
+	{"PTR", Token::Operator, 0},
+
+	{"AH", Token::Reg8, 4},
+	{"BH", Token::Reg8, 7},
+	{"CH", Token::Reg8, 5},
+	{"DH", Token::Reg8, 6},
+	{"AL", Token::Reg8, 0},
+	{"BL", Token::Reg8, 3},
+	{"CL", Token::Reg8, 1},
+	{"DL", Token::Reg8, 2},
+
+	{"EAX", Token::Reg32, 0},
+	{"EBX", Token::Reg32, 3},
+	{"ECX", Token::Reg32, 1},
+	{"EDX", Token::Reg32, 2},
+	{"ESI", Token::Reg32, 6},
+	{"EDI", Token::Reg32, 7},
+	{"ESP", Token::Reg32, 4},
+	{"EBP", Token::Reg32, 5},
+
+	{"CS", Token::SReg, 1},
+	{"DS", Token::SReg, 3},
+	{"SS", Token::SReg, 2},
+	{"ES", Token::SReg, 0},
+	{"FS", Token::SReg, 4},
+	{"GS", Token::SReg, 5},
+
+	{"STOSD", Token::Command, 0},
+	{"DEC", Token::Command, 0},
+	{"INC", Token::Command, 0},
+	{"XOR", Token::Command, 0},
+	{"OR", Token::Command, 0},
+	{"AND", Token::Command, 0},
+	{"MOV", Token::Command, 0},
+	{"ADC", Token::Command, 0},
+	{"JZ", Token::Command, 0}
+};
+
+constexpr Dialect stage7 = {stage7Keywords, "+-*:,[]", "'\"", Dialect::HexSuffix, true, false, false};
+
+#endif
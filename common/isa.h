@@ -0,0 +1,66 @@
+#ifndef ISA_H
+#define ISA_H
+
+// Instructions are described by a table with one row per encoding: the
+// mnemonic, the operand forms the row accepts, the opcode and how the rest of
+// the instruction is laid out. The rows of a mnemonic are reached by indexing
+// with its keyword, and the first of them whose forms match the operands is
+// the one assembled.
+
+// What an operand is, one bit each, so that a row may accept several.
+struct Form {
+	enum : unsigned char {
+		None = 1, R8 = 2, R16 = 4, R32 = 8, Imm = 16, Mem = 32, Label = 64
+	};
+};
+
+struct Instruction {
+	enum Encoding : unsigned char {
+		Plain,    // the opcode alone
+		PlusReg,  // the register of the first operand added to the opcode
+		ModRM,    // ModRM after the opcode, then SIB and disp32 for memory
+		Jump      // short or near, relative to the next instruction
+	};
+	enum Immediate : unsigned char {
+		NoImm, Imm8, Imm32,
+		ImmPtr    // as wide as the memory operand, 8 bits when it fits
+	};
+
+	int mnemonic;
+	unsigned char forms[2];
+	unsigned char opcode;
+	// The /digit in the reg field of ModRM, -1 for a register operand.
+	signed char ext;
+	Encoding encoding;
+	Immediate imm;
+};
+
+struct InstructionSet {
+	const Instruction *rows;
+	// Rows of each keyword: [first, first + count) of the table.
+	unsigned char first[256], count[256];
+
+	// The rows of a mnemonic have to be next to each other.
+	template<int N>
+	constexpr InstructionSet(const Instruction (&rows)[N]) : rows(rows), first(), count() {
+		static_assert(N < 256, "too many rows for the index");
+		for (int i = 0; i < N; i++) {
+			int mnemonic = rows[i].mnemonic;
+			if (count[mnemonic] && (first[mnemonic] + count[mnemonic] != i)) throw "rows of a mnemonic are apart";
+			if (!count[mnemonic]) first[mnemonic] = i;
+			count[mnemonic]++;
+		}
+	}
+
+	// The row for operands of the given forms, null for none.
+	const Instruction *find(int mnemonic, unsigned forms0, unsigned forms1) const {
+		if ((mnemonic < 0) || (mnemonic > 255)) return nullptr;
+		const Instruction *row = rows + first[mnemonic], *end = row + count[mnemonic];
+		for (; row != end; row++) {
+			if ((row->forms[0] & forms0) && (row->forms[1] & forms1)) return row;
+		}
+		return nullptr;
+	}
+};
+
+#endif
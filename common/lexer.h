@@ -0,0 +1,342 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+// Lexer shared by the C++ stages. It never allocates: tokens are views into
+// the line being lexed, and everything that differs between the stages
+// (keywords, delimiters, quotes, number syntax) lives in a constexpr Dialect.
+
+#include <string_view>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+inline char upcase(char c) {
+	return ((c >= 'a') && (c <= 'z')) ? c - 'a' + 'A' : c;
+}
+
+inline char downcase(char c) {
+	return ((c >= 'A') && (c <= 'Z')) ? c - 'A' + 'a' : c;
+}
+
+struct Token {
+	enum Type : unsigned char {
+		Unknown,
+		OneChar,
+		Number,
+		String,
+		Identifier,
+		Directive,
+		DataType,
+		PtrType,
+		Operator,
+		Reg8,
+		Reg16,
+		Reg32,
+		SReg,
+		Command
+	} type;
+	std::string_view text;
+	int keyword, radix, begin, end;
+	long value;
+};
+
+struct Keyword {
+	const char *text;
+	Token::Type type;
+	int code;
+};
+
+// Perfect hash over a keyword list. The seed is searched at compile time
+// until every keyword lands in its own slot, so a lookup is one hash, one
+// probe and one case-insensitive compare straight on the source bytes.
+// Keyword texts must be upper case.
+struct KeywordTable {
+	const Keyword *keywords;
+	int count, maxLength;
+	unsigned seed;
+	unsigned char slots[256];
+
+	static constexpr unsigned hash(unsigned seed, const char *text, int length) {
+		unsigned hash = seed ^ length;
+		for (int i = 0; i < length; i++) {
+			hash = (hash ^ (text[i] | 0x20)) * 0x01000193;
+		}
+		return (hash ^ (hash >> 16)) & 255;
+	}
+
+	static constexpr int length(const char *text) {
+		int length = 0;
+		while (text[length]) length++;
+		return length;
+	}
+
+	static constexpr bool equals(const char *a, const char *b) {
+		while (*a && (*a == *b)) a++, b++;
+		return *a == *b;
+	}
+
+	template <int N>
+	constexpr KeywordTable(const Keyword (&keywords)[N]) : keywords(keywords), count(N), maxLength(0), seed(0), slots() {
+		static_assert(N < 256, "too many keywords for the table");
+		for (int i = 0; i < count; i++) {
+			if (length(keywords[i].text) > maxLength) maxLength = length(keywords[i].text);
+		}
+		while (!place()) seed++;
+	}
+
+	constexpr bool place() {
+		for (auto &slot : slots) slot = 0;
+		for (int i = 0; i < count; i++) {
+			unsigned char &slot = slots[hash(seed, keywords[i].text, length(keywords[i].text))];
+			if (slot) return false;
+			slot = i + 1;
+		}
+		return true;
+	}
+
+	// Index of an upper-case keyword, for comparing against Token::keyword.
+	constexpr int find(const char *text) const {
+		for (int i = 0; i < count; i++) {
+			if (equals(keywords[i].text, text)) return i;
+		}
+		return -1;
+	}
+
+	int classify(const char *text, int length) const {
+		if (length > maxLength) return -1;
+		int slot = slots[hash(seed, text, length)];
+		if (!slot) return -1;
+		const char *keyword = keywords[slot - 1].text;
+		for (int i = 0; i < length; i++) {
+			if (upcase(text[i]) != keyword[i]) return -1;
+		}
+		return keyword[length] ? -1 : slot - 1;
+	}
+
+	constexpr const Keyword &operator[](int index) const {
+		return keywords[index];
+	}
+};
+
+struct Dialect {
+	enum Numbers {
+		HexSuffix,   // hex digits that must end with H
+		RadixSuffix, // H, B or D suffix, decimal without one
+		HexDigits    // hex digits with an optional H
+	};
+
+	KeywordTable keywords;
+	const char *onechars, *quotes;
+	Numbers numbers;
+	bool keepSuffix, keepQuotes, lower;
+
+	// The case a stage prints and compares names in.
+	char fold(char c) const {
+		return lower ? downcase(c) : upcase(c);
+	}
+
+	bool isonechar(char c) const {
+		return c && strchr(onechars, c);
+	}
+
+	bool isquote(char c) const {
+		return c && strchr(quotes, c);
+	}
+};
+
+// Character classes for the line scanner. Each one tests a single byte, 16
+// bytes at once with SSE2 or 32 with AVX2, and scan<>() uses the widest kernel
+// the build was compiled for to jump over whole runs of a class.
+struct SpaceClass {
+	static bool test(char c) { return (c == ' ') || ((c >= '\t') && (c <= '\r')); }
+#ifdef __SSE2__
+	static unsigned mask(__m128i v) {
+		__m128i space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+		__m128i control = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('\t' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('\r' + 1)));
+		return _mm_movemask_epi8(_mm_or_si128(space, control));
+	}
+#endif
+#ifdef __AVX2__
+	static unsigned mask(__m256i v) {
+		__m256i space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+		__m256i control = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('\t' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), v));
+		return _mm256_movemask_epi8(_mm256_or_si256(space, control));
+	}
+#endif
+};
+
+struct AlNumClass {
+	static bool test(char c) { return (((c | 0x20) >= 'a') && ((c | 0x20) <= 'z')) || ((c >= '0') && (c <= '9')); }
+#ifdef __SSE2__
+	static unsigned mask(__m128i v) {
+		__m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+		__m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+		__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+		return _mm_movemask_epi8(_mm_or_si128(alpha, digit));
+	}
+#endif
+#ifdef __AVX2__
+	static unsigned mask(__m256i v) {
+		__m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+		__m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+		__m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+		return _mm256_movemask_epi8(_mm256_or_si256(alpha, digit));
+	}
+#endif
+};
+
+struct XDigitClass {
+	static bool test(char c) { return (((c | 0x20) >= 'a') && ((c | 0x20) <= 'f')) || ((c >= '0') && (c <= '9')); }
+#ifdef __SSE2__
+	static unsigned mask(__m128i v) {
+		__m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+		__m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+		__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+		return _mm_movemask_epi8(_mm_or_si128(alpha, digit));
+	}
+#endif
+#ifdef __AVX2__
+	static unsigned mask(__m256i v) {
+		__m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+		__m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lower));
+		__m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+		return _mm256_movemask_epi8(_mm256_or_si256(alpha, digit));
+	}
+#endif
+};
+
+// Returns the index of the first character in [i, n) whose membership in Class
+// equals stop, or n. Most runs in a source are a few characters long, which
+// the scalar loop does faster than a vector load, so only a run longer than
+// ScalarRun goes on in the kernels; with vectorized off, none does.
+template <class Class, bool stop>
+int scan(const char *s, int i, int n, bool vectorized) {
+	const int ScalarRun = 16;
+	for (int end = i + ScalarRun < n ? i + ScalarRun : n; i < end; i++) {
+		if (Class::test(s[i]) == stop) return i;
+	}
+	if (vectorized) {
+#ifdef __AVX2__
+		for (; i + 32 <= n; i += 32) {
+			unsigned mask = Class::mask(_mm256_loadu_si256((const __m256i *)(s + i)));
+			if (!stop) mask = ~mask;
+			if (mask) return i + __builtin_ctz(mask);
+		}
+#endif
+#ifdef __SSE2__
+		for (; i + 16 <= n; i += 16) {
+			unsigned mask = Class::mask(_mm_loadu_si128((const __m128i *)(s + i)));
+			if (!stop) mask = ~mask & 0xFFFF;
+			if (mask) return i + __builtin_ctz(mask);
+		}
+#endif
+	}
+	while ((i < n) && (Class::test(s[i]) != stop)) i++;
+	return i;
+}
+
+inline int digit(char c) {
+	if ((c >= '0') && (c <= '9')) return c - '0';
+	if (((c | 0x20) >= 'a') && ((c | 0x20) <= 'z')) return (c | 0x20) - 'a' + 10;
+	return 99;
+}
+
+// Value of the leading digits of text in the given radix, like stol.
+inline long parseNumber(const std::string_view &text, int radix) {
+	long value = 0;
+	for (char c : text) {
+		if (digit(c) >= radix) break;
+		value = value * radix + digit(c);
+	}
+	return value;
+}
+
+// Splits one line into tokens. A ';' outside a string ends the line. error is
+// set once the line holds a malformed number, an unterminated string or a
+// character the dialect does not know; the offending token is Unknown.
+struct Lexer {
+	const Dialect &dialect;
+	std::string_view line;
+	int position;
+	bool error, vectorized;
+
+	Lexer(const Dialect &dialect, const std::string_view &line) : dialect(dialect), line(line), position(0), error(false), vectorized(true) {}
+
+	bool next(Token &token) {
+		const char *s = line.data();
+		int size = line.size(), &i = position;
+
+		i = scan<SpaceClass, false>(s, i, size, vectorized);
+		if ((i == size) || (s[i] == ';')) return false;
+
+		token.type = Token::Unknown;
+		token.keyword = -1;
+		token.radix = 0;
+		token.value = 0;
+		token.begin = i;
+
+		if (isalpha(s[i])) {
+			i = token.end = scan<AlNumClass, false>(s, i, size, vectorized);
+			token.keyword = dialect.keywords.classify(s + token.begin, token.end - token.begin);
+			token.type = (token.keyword == -1) ? Token::Identifier : dialect.keywords[token.keyword].type;
+		} else if (isdigit(s[i])) {
+			number(token);
+		} else if (dialect.isquote(s[i])) {
+			char quote = s[i++];
+			const char *close = (const char *)memchr(s + i, quote, size - i);
+			if (close) {
+				token.type = Token::String;
+				token.end = close - s;
+				i = token.end + 1;
+			} else {
+				error = true;
+				token.end = i = size;
+			}
+			if (!dialect.keepQuotes) token.begin++;
+			else if (close) token.end++;
+		} else if (dialect.isonechar(s[i])) {
+			token.type = Token::OneChar;
+			token.end = ++i;
+		} else {
+			error = true;
+			token.end = ++i;
+		}
+
+		token.text = line.substr(token.begin, token.end - token.begin);
+		if (token.type == Token::Unknown) token.text = std::string_view();
+		return true;
+	}
+
+	void number(Token &token) {
+		const char *s = line.data();
+		int size = line.size(), &i = position;
+
+		i = token.end = scan<XDigitClass, false>(s, i, size, vectorized);
+		char suffix = 0;
+		if ((i < size) && ((s[i] | 0x20) == 'h')) {
+			token.radix = 16;
+			suffix = s[i++];
+		} else if (dialect.numbers == Dialect::HexSuffix) {
+			error = true;
+			return;
+		} else if (dialect.numbers == Dialect::HexDigits) {
+			token.radix = 16;
+		} else if ((s[i - 1] | 0x20) == 'b') {
+			token.radix = 2;
+			suffix = s[--token.end];
+		} else if ((s[i - 1] | 0x20) == 'd') {
+			token.radix = 10;
+			suffix = s[--token.end];
+		} else {
+			token.radix = 10;
+		}
+
+		token.type = Token::Number;
+		token.value = parseNumber(line.substr(token.begin, token.end - token.begin), token.radix);
+		if (suffix && dialect.keepSuffix) token.end = i;
+	}
+};
+
+#endif
@@ -0,0 +1,219 @@
+#ifndef OPERAND_H
+#define OPERAND_H
+
+// Operands are parsed by a small automaton. Every lexem is reduced to a Term
+// once, when the line is split, and each stage describes the operands it
+// accepts as a transition table over term classes: for a state and a class
+// it says what to record, which state comes next and whether the lexem is
+// consumed. The result is a fixed-size Descriptor.
+
+#include "lexer.h"
+
+// What the operand parser sees of one lexem.
+struct Term {
+	enum Class : unsigned char {
+		End, PtrType, Ptr, Reg8, Reg16, Reg32, SReg, Number, String, Identifier,
+		Colon, Open, Close, Plus, Star, Other, Classes
+	} type;
+	signed char code;
+	int symbol;
+	long value;
+
+	Term() : type(Other), code(0), symbol(-1), value(0) {}
+	Term(Class type, int code = 0, long value = 0, int symbol = -1) : type(type), code(code), symbol(symbol), value(value) {}
+
+	// code is the keyword's code from the dialect: register number or size.
+	static Term of(const Token &token, int code) {
+		switch (token.type) {
+			case Token::PtrType: return Term(PtrType, code);
+			case Token::Operator: return Term(Ptr);
+			case Token::Reg8: return Term(Reg8, code);
+			case Token::Reg16: return Term(Reg16, code);
+			case Token::Reg32: return Term(Reg32, code);
+			case Token::SReg: return Term(SReg, code);
+			case Token::Number: return Term(Number, 0, token.value);
+			case Token::String: return Term(String);
+			case Token::Identifier: return Term(Identifier);
+			case Token::OneChar:
+				switch (token.text[0]) {
+					case ':': return Term(Colon);
+					case '[': return Term(Open);
+					case ']': return Term(Close);
+					case '+': return Term(Plus);
+					case '*': return Term(Star);
+				}
+				return Term(Other);
+			default: return Term(Other);
+		}
+	}
+};
+
+inline const Term &termOf(const Term &term) {
+	return term;
+}
+
+template<class Lexem>
+const Term &termOf(const Lexem &lexem) {
+	return lexem.term;
+}
+
+// A register of an operand and the position of its lexem in the operand.
+struct Register {
+	Term::Class type;
+	signed char code, at;
+
+	Register() : type(Term::End), code(-1), at(-1) {}
+
+	void set(const Term &term, int at) {
+		this->type = term.type;
+		this->code = term.code;
+		this->at = at;
+	}
+
+	bool present() const {
+		return type != Term::End;
+	}
+
+	bool is(Term::Class type, int code) const {
+		return (this->type == type) && (this->code == code);
+	}
+};
+
+struct Descriptor {
+	enum Kind : unsigned char { Undef, Reg, Imm, Text, Name, Mem } kind;
+	enum Part : unsigned short {
+		PtrPart = 1, RegPart = 2, ImmPart = 4, TextPart = 8, SRegPart = 16,
+		IdentPart = 32, BasePart = 64, IndexPart = 128, ScalePart = 256, DispPart = 512
+	};
+
+	unsigned short parts;
+	bool valid;
+	signed char ptr, scale;
+	// Position of the identifier and of the string within the operand.
+	signed char ident, text;
+	Register reg, base, index, sreg;
+	int symbol;
+	long imm, disp;
+
+	Descriptor() : kind(Undef), parts(0), valid(true), ptr(0), scale(0), ident(-1), text(-1), symbol(-1), imm(0), disp(0) {}
+
+	bool has(unsigned parts) const {
+		return (this->parts & parts) != 0;
+	}
+};
+
+enum OperandAction : unsigned char {
+	Skip, PendPtr, SetPtr, SetReg, SetImm, SetText, PendSReg, SetSReg,
+	SetIdent, OpenMem, SetBase, SetIndex, SetScale, SetDisp
+};
+
+struct Transition {
+	unsigned char next;
+	OperandAction action;
+	bool consume;
+};
+
+// A rule for class Term::Classes is the default of its state.
+struct Rule {
+	unsigned char state;
+	Term::Class type;
+	unsigned char next;
+	OperandAction action;
+	bool consume;
+};
+
+struct OperandGrammar {
+	enum { States = 16, Accept = States - 2, Reject = States - 1 };
+
+	Transition table[States][Term::Classes];
+
+	// States without a default reject every class they have no rule for.
+	template<size_t count>
+	constexpr OperandGrammar(const Rule (&rules)[count]) : table{} {
+		for (int state = 0; state < States; state++) {
+			for (int type = 0; type < Term::Classes; type++) {
+				table[state][type] = {Reject, Skip, false};
+			}
+		}
+		for (const Rule &rule : rules) {
+			if (rule.type != Term::Classes) continue;
+			for (int type = 0; type < Term::Classes; type++) {
+				table[rule.state][type] = {rule.next, rule.action, rule.consume};
+			}
+		}
+		for (const Rule &rule : rules) {
+			if (rule.type == Term::Classes) continue;
+			table[rule.state][rule.type] = {rule.next, rule.action, rule.consume};
+		}
+	}
+
+	// Lexem is a Term, or anything with a Term member named term.
+	template<class Lexem>
+	Descriptor parse(const Lexem *lexems, int count) const {
+		Descriptor operand;
+		Term end(Term::End), pending;
+		int state = 0, i = 0, at = 0;
+		while (state < Accept) {
+			const Term &term = i < count ? termOf(lexems[i]) : end;
+			const Transition &transition = table[state][term.type];
+			switch (transition.action) {
+				case Skip: break;
+				case PendPtr:
+				case PendSReg:
+					pending = term;
+					at = i;
+					break;
+				case SetPtr:
+					operand.ptr = pending.code;
+					operand.parts |= Descriptor::PtrPart;
+					break;
+				case SetReg:
+					operand.kind = Descriptor::Reg;
+					operand.reg.set(term, i);
+					operand.parts |= Descriptor::RegPart;
+					break;
+				case SetImm:
+					operand.kind = Descriptor::Imm;
+					operand.imm = term.value;
+					operand.parts |= Descriptor::ImmPart;
+					break;
+				case SetText:
+					operand.kind = Descriptor::Text;
+					operand.text = i;
+					operand.parts |= Descriptor::TextPart;
+					break;
+				case SetSReg:
+					operand.sreg.set(pending, at);
+					operand.parts |= Descriptor::SRegPart;
+					break;
+				case SetIdent:
+					operand.kind = Descriptor::Name;
+					operand.ident = i;
+					operand.symbol = term.symbol;
+					operand.parts |= Descriptor::IdentPart;
+					break;
+				case OpenMem: operand.kind = Descriptor::Mem; break;
+				case SetBase:
+					operand.base.set(term, i);
+					operand.parts |= Descriptor::BasePart;
+					break;
+				case SetIndex:
+					operand.index.set(term, i);
+					operand.scale = 1;
+					operand.parts |= Descriptor::IndexPart | Descriptor::ScalePart;
+					break;
+				case SetScale: operand.scale = term.value; break;
+				case SetDisp:
+					operand.disp = term.value;
+					operand.parts |= Descriptor::DispPart;
+					break;
+			}
+			if (transition.consume) i++;
+			state = transition.next;
+		}
+		operand.valid = state == Accept;
+		return operand;
+	}
+};
+
+#endif